@@ -0,0 +1,166 @@
+/* ncdu - NCurses Disk Usage
+
+  Copyright (c) 2020 Yoran Heling
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+#include "global.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#if HAVE_SYS_MMAN_H && HAVE_MADVISE
+#include <sys/mman.h>
+#endif
+
+
+#define CHUNK_HDR ((sizeof(struct arena_chunk) + 7) & ~7)
+
+struct arena_chunk **arena_chunks;
+int64_t arena_mem;
+int64_t arena_used;
+static uint32_t chunk_free; /* lowest index in arena_chunks that may be free */
+
+
+static void chunk_new(struct arena *a) {
+  struct arena_chunk *c;
+
+  if(!arena_chunks)
+    arena_chunks = xcalloc(ARENA_MAX_CHUNKS, sizeof(*arena_chunks));
+  while(chunk_free < ARENA_MAX_CHUNKS && arena_chunks[chunk_free])
+    chunk_free++;
+  if(chunk_free == ARENA_MAX_CHUNKS) {
+    close_nc();
+    fprintf(stderr, "Too many items, ncdu can't keep more than %d MiB of items in memory.\n", (ARENA_MAX_CHUNKS/1024)*(ARENA_CHUNK/1024));
+    exit(1);
+  }
+
+  c = treefile_active ? treefile_arena_chunk(chunk_free) : xmemalign(ARENA_CHUNK, ARENA_CHUNK);
+  c->id = chunk_free;
+  arena_chunks[chunk_free] = c;
+  arena_mem += ARENA_CHUNK;
+
+#if HAVE_SYS_MMAN_H && HAVE_MADVISE && defined(MADV_HUGEPAGE)
+  /* Large trees benefit from transparent huge pages, but don't bother with
+   * the first chunk; most refreshes only need a tiny bit of memory. */
+  if(a->chunk && !treefile_active)
+    madvise(c, ARENA_CHUNK, MADV_HUGEPAGE);
+#endif
+
+  c->arena = a;
+  c->next = a->chunk;
+  a->chunk = c;
+  a->ptr = (char *)c + CHUNK_HDR;
+  a->end = (char *)c + ARENA_CHUNK;
+}
+
+
+struct arena *arena_reopen(const unsigned char *used) {
+  struct arena *a = arena_create(NULL);
+  struct arena_chunk *c;
+  uint32_t id;
+
+  if(!arena_chunks)
+    arena_chunks = xcalloc(ARENA_MAX_CHUNKS, sizeof(*arena_chunks));
+  for(id=0; id<ARENA_MAX_CHUNKS; id++) {
+    if(!(used[id/8] & 1<<(id%8)))
+      continue;
+    c = treefile_arena_chunk(id);
+    arena_chunks[id] = c;
+    arena_mem += ARENA_CHUNK;
+    c->arena = a;
+    c->next = a->chunk;
+    a->chunk = c;
+  }
+  /* The free space in these chunks is lost, new items go into a new chunk */
+  a->ptr = a->end = NULL;
+  return a;
+}
+
+
+struct arena *arena_create(struct arena *parent) {
+  struct arena *a = xcalloc(1, sizeof(struct arena));
+  a->parent = parent;
+  if(parent)
+    parent->nested++;
+  return a;
+}
+
+
+void *arena_alloc(struct arena *a, size_t size) {
+  void *r;
+
+  size = (size + 7) & ~(size_t)7;
+  a->nodes++;
+  a->used += size;
+  arena_used += size;
+  if(size/8 < ARENA_FREE_LISTS && (r = a->freed[size/8]) != NULL) {
+    a->freed[size/8] = *(void **)r;
+    return r;
+  }
+  if(!a->chunk || (size_t)(a->end - a->ptr) < size)
+    chunk_new(a);
+  r = a->ptr;
+  a->ptr += size;
+  return r;
+}
+
+
+struct arena *arena_of(const void *ptr) {
+  return arena_chunk_of(ptr)->arena;
+}
+
+
+void arena_free(void *ptr, size_t size) {
+  struct arena *a = arena_of(ptr);
+
+  size = (size + 7) & ~(size_t)7;
+  a->used -= size;
+  arena_used -= size;
+  if(!--a->nodes)
+    arena_destroy(a);
+  else if(size/8 < ARENA_FREE_LISTS) {
+    *(void **)ptr = a->freed[size/8];
+    a->freed[size/8] = ptr;
+  }
+}
+
+
+void arena_destroy(struct arena *a) {
+  struct arena_chunk *c, *n;
+
+  for(c=a->chunk; c; c=n) {
+    n = c->next;
+    arena_chunks[c->id] = NULL;
+    if(c->id < chunk_free)
+      chunk_free = c->id;
+    if(treefile_active)
+      treefile_arena_release(c->id);
+    else
+      free(c);
+    arena_mem -= ARENA_CHUNK;
+  }
+  arena_used -= a->used;
+  if(a->parent)
+    a->parent->nested--;
+  free(a);
+}
@@ -0,0 +1,127 @@
+/* ncdu - NCurses Disk Usage
+
+  Copyright (c) 2020 Yoran Heling
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+#ifndef _arena_h
+#define _arena_h
+
+#include "global.h"
+
+
+/* Memory for struct dir nodes is allocated from arenas: a list of large,
+ * aligned chunks that are handed out with a simple bump pointer. There is no
+ * per-node malloc() overhead and freeing a node only puts it on a free list
+ * for later allocations of the same size; the chunks are released when the
+ * last node in the arena has been freed (or at once with arena_destroy()).
+ *
+ * Every scan gets its own arena, so the subtree created by a refresh lives in
+ * an arena of its own and can be dropped in a single go when it is refreshed
+ * or deleted again. */
+
+/* Size of a single chunk, chunks are also aligned to this size. */
+#define ARENA_CHUNK_BITS 21
+#define ARENA_CHUNK (1<<ARENA_CHUNK_BITS)
+
+/* Nodes refer to each other with 32-bit references rather than pointers. A
+ * reference holds the index of the chunk in the global chunk table and the
+ * offset of the node within that chunk in units of 8 bytes. With 2 MiB chunks
+ * that leaves room for 16384 chunks, i.e. 32 GiB worth of nodes. Offset 0 is
+ * always taken by the chunk header, so a reference of 0 is the NULL
+ * reference. */
+#define ARENA_OFF_BITS   (ARENA_CHUNK_BITS-3)
+#define ARENA_MAX_CHUNKS (1<<(32-ARENA_OFF_BITS))
+
+/* Header at the start of each chunk */
+struct arena_chunk {
+  struct arena *arena;
+  struct arena_chunk *next;
+  uint32_t id;              /* index in arena_chunks */
+};
+
+extern struct arena_chunk **arena_chunks;
+
+/* Total size of all allocated chunks */
+extern int64_t arena_mem;
+
+/* Total size of the nodes that are currently allocated */
+extern int64_t arena_used;
+
+/* Freed nodes are kept in a list per size, in steps of 8 bytes. Larger nodes
+ * are not reused. */
+#define ARENA_FREE_LISTS 16
+
+struct arena {
+  char *ptr, *end;          /* free space in the current chunk */
+  struct arena_chunk *chunk;/* linked list of chunks, current one first */
+  int64_t nodes;            /* number of allocated (not yet freed) nodes */
+  int64_t used;             /* total size of these nodes */
+  void *freed[ARENA_FREE_LISTS]; /* freed nodes, linked through their first bytes */
+  int64_t hlnkc;            /* number of FF_HLNKC nodes, maintained by the caller */
+  int nested;               /* number of arenas for subtrees within this one */
+  struct arena *parent;     /* arena this one is nested in, if any */
+  struct dir *owner;        /* root of the subtree that this arena was created for */
+};
+
+/* Creates a new arena, nested in the given parent arena (may be NULL). */
+struct arena *arena_create(struct arena *);
+
+/* Creates an arena from the chunks in the tree file that are marked in the
+ * given bitmap. The node counts and owner must be set by the caller. */
+struct arena *arena_reopen(const unsigned char *);
+
+/* Allocates memory from the arena, the returned pointer is 8-byte aligned and
+ * the memory is NOT initialized. */
+void *arena_alloc(struct arena *, size_t);
+
+/* Returns the arena the given pointer has been allocated from. */
+struct arena *arena_of(const void *);
+
+/* Marks a single allocation of the given size as free, the arena is
+ * destroyed when no allocations are left. */
+void arena_free(void *, size_t);
+
+/* Releases all memory of the arena at once, regardless of the number of nodes
+ * that are still allocated. */
+void arena_destroy(struct arena *);
+
+
+static inline struct arena_chunk *arena_chunk_of(const void *ptr) {
+  return (struct arena_chunk *)((uintptr_t)ptr & ~(uintptr_t)(ARENA_CHUNK-1));
+}
+
+/* Converts between pointers and references */
+static inline uint32_t dir_ref(const struct dir *d) {
+  return !d ? 0 :
+    (arena_chunk_of(d)->id << ARENA_OFF_BITS) | (uint32_t)(((uintptr_t)d & (ARENA_CHUNK-1)) >> 3);
+}
+
+static inline struct dir *dir_ptr(uint32_t ref) {
+  return !ref ? NULL :
+    (struct dir *)((char *)arena_chunks[ref >> ARENA_OFF_BITS] + ((size_t)(ref & ((1<<ARENA_OFF_BITS)-1)) << 3));
+}
+
+#define dir_parent(d) dir_ptr((d)->parent)
+#define dir_next(d)   dir_ptr((d)->next)
+#define dir_sub(d)    dir_ptr((d)->sub)
+
+#endif
@@ -34,17 +34,36 @@
 static int graph = 1, show_as = 0, info_show = 0, info_page = 0, info_start = 0, show_items = 0, show_mtime = 0;
 static const char *message = NULL;
 
+/* Set while a filter is being typed, most keys go to the filter then */
+static int filtering = 0;
+
+/* The items drawn on the rows of the list in the previous frame, so that a
+ * frame in which only the selection moved only has to redraw the rows that
+ * changed. Anything else sets full_redraw. drawn_ui is the dir_ui of that
+ * frame. */
+static struct dir **drawn = NULL;
+static int drawn_rows = 0, drawn_cols = 0, drawn_sel = -1, drawn_ui = 0, full_redraw = 1;
+
+/* Actions that change the tree or the working directory have to wait for a
+ * scan in the background to finish */
+static const char busy[] = "Not available until the scan has finished.";
+
+/* The totals of the opened directory, which a scan in the background may
+ * still be adding to, or of the items that match the filter */
+static int64_t par_size, par_asize;
+static int par_items;
+
 
 
 static void browse_draw_info(struct dir *dr) {
-  struct dir *t;
-  struct dir_ext *e = dir_ext_ptr(dr);
+  struct dir *t, *hl = dir_hlnk(dr);
+  struct dir_ext *e = dir_ext_get(dr);
   char mbuf[46];
   int i;
 
   nccreate(11, 60, "Item info");
 
-  if(dr->hlnk) {
+  if(hl) {
     nctab(41, info_page == 0, 1, "Info");
     nctab(50, info_page == 1, 2, "Links");
   }
@@ -66,8 +85,8 @@ static void browse_draw_info(struct dir *dr) {
     ncaddstr(7, 3, "Apparent size:");
     attroff(A_BOLD);
 
-    ncaddstr(2,  9, cropstr(dr->name, 49));
-    ncaddstr(3,  9, cropstr(getpath(dr->parent), 49));
+    ncaddstr(2,  9, cropstr(dir_name(dr), 49));
+    ncaddstr(3,  9, cropstr(getpath(dir_parent(dr)), 49));
     ncaddstr(4,  9, dr->flags & FF_DIR ? "Directory" : dr->flags & FF_FILE ? "File" : "Other");
 
     if(e) {
@@ -93,7 +112,7 @@ static void browse_draw_info(struct dir *dr) {
     break;
 
   case 1:
-    for(i=0,t=dr->hlnk; t!=dr; t=t->hlnk,i++) {
+    for(i=0,t=hl; t!=dr; t=dir_hlnk(t),i++) {
       if(info_start > i)
         continue;
       if(i-info_start > 5)
@@ -116,6 +135,8 @@ static void browse_draw_flag(struct dir *n, int *x) {
       n == dirlist_parent ? ' ' :
         n->flags & FF_EXL ? '<' :
         n->flags & FF_ERR ? '!' :
+        n->flags & FF_INC ? '?' :
+       n->flags & FF_COLL ? '+' :
        n->flags & FF_SERR ? '.' :
       n->flags & FF_OTHFS ? '>' :
      n->flags & FF_KERNFS ? '^' :
@@ -124,13 +145,13 @@ static void browse_draw_flag(struct dir *n, int *x) {
      !(n->flags & FF_FILE
     || n->flags & FF_DIR) ? '@' :
         n->flags & FF_DIR
-        && n->sub == NULL ? 'e' :
+        && !n->sub ? 'e' :
                             ' ');
   *x += 2;
 }
 
 
-static void browse_draw_graph(struct dir *n, int *x) {
+static void browse_draw_graph(struct dir *n, int64_t size, int *x) {
   float pc = 0.0f;
   int o, i;
   enum ui_coltype c = n->flags & FF_BSEL ? UIC_SEL : UIC_DEFAULT;
@@ -146,11 +167,11 @@ static void browse_draw_graph(struct dir *n, int *x) {
 
   /* percentage (6 columns) */
   if(graph == 2 || graph == 3) {
-    pc = (float)(show_as ? n->parent->asize : n->parent->size);
+    pc = (float)(show_as ? par_asize : par_size);
     if(pc < 1)
       pc = 1.0f;
     uic_set(c == UIC_SEL ? UIC_NUM_SEL : UIC_NUM);
-    printw("%5.1f", ((float)(show_as ? n->asize : n->size) / pc) * 100.0f);
+    printw("%5.1f", ((float)size / pc) * 100.0f);
     addchc(c, '%');
   }
 
@@ -160,7 +181,7 @@ static void browse_draw_graph(struct dir *n, int *x) {
   /* graph (10 columns) */
   if(graph == 1 || graph == 3) {
     uic_set(c == UIC_SEL ? UIC_GRAPH_SEL : UIC_GRAPH);
-    o = (int)(10.0f*(float)(show_as ? n->asize : n->size) / (float)(show_as ? dirlist_maxa : dirlist_maxs));
+    o = (int)(10.0f*(float)size / (float)(show_as ? dirlist_maxa : dirlist_maxs));
     for(i=0; i<10; i++)
       addch(i < o ? '#' : ' ');
   }
@@ -169,7 +190,7 @@ static void browse_draw_graph(struct dir *n, int *x) {
 }
 
 
-static void browse_draw_items(struct dir *n, int *x) {
+static void browse_draw_items(struct dir *n, int items, int *x) {
   enum ui_coltype c = n->flags & FF_BSEL ? UIC_SEL : UIC_DEFAULT;
   enum ui_coltype cn = c == UIC_SEL ? UIC_NUM_SEL : UIC_NUM;
 
@@ -177,18 +198,18 @@ static void browse_draw_items(struct dir *n, int *x) {
     return;
   *x += 7;
 
-  if(!n->items)
+  if(!items)
     return;
-  else if(n->items < 100*1000) {
+  else if(items < 100*1000) {
     uic_set(cn);
-    printw("%6s", fullsize(n->items));
-  } else if(n->items < 1000*1000) {
+    printw("%6s", fullsize(items));
+  } else if(items < 1000*1000) {
     uic_set(cn);
-    printw("%5.1f", n->items / 1000.0);
+    printw("%5.1f", items / 1000.0);
     addstrc(c, "k");
-  } else if(n->items < 1000*1000*1000) {
+  } else if(items < 1000*1000*1000) {
     uic_set(cn);
-    printw("%5.1f", n->items / 1e6);
+    printw("%5.1f", items / 1e6);
     addstrc(c, "M");
   } else {
     addstrc(c, "  > ");
@@ -201,18 +222,16 @@ static void browse_draw_items(struct dir *n, int *x) {
 static void browse_draw_mtime(struct dir *n, int *x) {
   enum ui_coltype c = n->flags & FF_BSEL ? UIC_SEL : UIC_DEFAULT;
   char mbuf[26];
-  struct dir_ext *e;
   time_t t;
 
   if (n->flags & FF_EXT) {
-    e = dir_ext_ptr(n);
-  } else if (!strcmp(n->name, "..") && (n->parent->flags & FF_EXT)) {
-    e = dir_ext_ptr(n->parent);
+    t = (time_t)dir_mtime(n);
+  } else if (n == dirlist_parent && (dirlist_par->flags & FF_EXT)) {
+    t = (time_t)dir_mtime(dirlist_par);
   } else {
     snprintf(mbuf, sizeof(mbuf), "no mtime");
     goto no_mtime;
   }
-  t = (time_t)e->mtime;
 
   strftime(mbuf, sizeof(mbuf), "%Y-%m-%d %H:%M:%S %z", localtime(&t));
   uic_set(c == UIC_SEL ? UIC_NUM_SEL : UIC_NUM);
@@ -223,7 +242,10 @@ no_mtime:
 
 
 static void browse_draw_item(struct dir *n, int row) {
-  int x = 0;
+  int scanning = dir_ui == 3 && n != dirlist_parent && dir_mem_scanning(dir_parent(n)) == n;
+  const char *mark = n == dir_refreshing ? " (refreshing...)" : scanning ? " (scanning...)" : NULL;
+  int64_t size, asize;
+  int x = 0, items, indent = dirlist_tree ? 2*dirlist_depth(n) : 0;
 
   enum ui_coltype c = n->flags & FF_BSEL ? UIC_SEL : UIC_DEFAULT;
   uic_set(c);
@@ -233,15 +255,22 @@ static void browse_draw_item(struct dir *n, int row) {
   browse_draw_flag(n, &x);
   move(row, x);
 
+  if(scanning)
+    dir_mem_live(n, &size, &asize, &items);
+  else {
+    size = n->size;
+    asize = n->asize;
+    items = n->items;
+  }
   if(n != dirlist_parent)
-    printsize(c, show_as ? n->asize : n->size);
+    printsize(c, show_as ? asize : size);
   x += 10;
   move(row, x);
 
-  browse_draw_graph(n, &x);
+  browse_draw_graph(n, show_as ? asize : size, &x);
   move(row, x);
 
-  browse_draw_items(n, &x);
+  browse_draw_items(n, items, &x);
   move(row, x);
 
   if (extended_info && show_mtime) {
@@ -249,76 +278,141 @@ static void browse_draw_item(struct dir *n, int row) {
     move(row, x);
   }
 
+  /* the contents of expanded directories in the tree view are indented */
+  if(indent > wincols-x-12)
+    indent = wincols-x-12 > 0 ? wincols-x-12 : 0;
+  x += indent;
+  move(row, x);
+
   if(n->flags & FF_DIR)
     c = c == UIC_SEL ? UIC_DIR_SEL : UIC_DIR;
   addchc(c, n->flags & FF_DIR ? '/' : ' ');
-  addstrc(c, cropstr(n->name, wincols-x-1));
+  if(mark) {
+    addstrc(c, cropstr(dir_name(n), wincols-x-1-(int)strlen(mark)));
+    addstrc(n->flags & FF_BSEL ? UIC_SEL : UIC_DEFAULT, mark);
+  } else
+    addstrc(c, cropstr(dir_name(n), wincols-x-1));
 }
 
 
 void browse_draw() {
   struct dir *t;
-  const char *tmp;
-  int selected = 0, i;
+  const char *tmp, *act;
+  int selected = -1, i, s, fx = wincols, fy = 1, fc = 0;
+
+  /* the items of a tree that is being read in the background keep changing,
+   * and are all replaced when the scan is done */
+  if((dir_ui == 3 && dirlist_update()) || dir_ui != drawn_ui)
+    full_redraw = 1;
+  drawn_ui = dir_ui;
+  if(*dirlist_filter)
+    dirlist_filter_totals(&par_size, &par_asize, &par_items);
+  else if(dirlist_par)
+    dir_mem_live(dirlist_par, &par_size, &par_asize, &par_items);
 
-  erase();
   t = dirlist_get(0);
 
+  if(full_redraw || !t || drawn_rows != winrows-3 || drawn_cols != wincols) {
+    erase();
+    if(drawn_rows != winrows-3) {
+      drawn_rows = winrows-3;
+      drawn = xrealloc(drawn, (drawn_rows > 0 ? drawn_rows : 1)*sizeof(*drawn));
+    }
+    drawn_cols = wincols;
+    for(i=0; i<drawn_rows; i++)
+      drawn[i] = NULL;
+    drawn_sel = -1;
+    full_redraw = 0;
+  }
+
   /* top line - basic info */
   uic_set(UIC_HD);
   mvhline(0, 0, ' ', wincols);
   mvprintw(0,0,"%s %s ~ Use the arrow keys to navigate, press ", PACKAGE_NAME, PACKAGE_VERSION);
   addchc(UIC_KEY_HD, '?');
   addstrc(UIC_HD, " for help");
-  if(dir_import_active)
+  if(dir_ui == 3) {
+    tmp = fullsize(dir_output.items);
+    act = dir_refreshing ? "refreshing" : dir_import_active ? "loading" : "scanning";
+    mvprintw(0, wincols-10-(int)strlen(act)-(int)strlen(tmp), "[%s, %s items]", act, tmp);
+  } else if(dir_import_active)
     mvaddstr(0, wincols-10, "[imported]");
   else if(read_only)
     mvaddstr(0, wincols-11, "[read-only]");
 
-  /* second line - the path */
+  /* second line - the path, and the filter on the right */
   mvhlinec(UIC_DEFAULT, 1, 0, '-', wincols);
+  if(filtering || *dirlist_filter) {
+    tmp = cropstr(dirlist_filter, wincols/3);
+    fx = wincols-13-(int)strlen(tmp);
+    mvaddstrc(UIC_DEFAULT, 1, fx, " Filter: ");
+    addstrc(UIC_DIR, tmp);
+    getyx(stdscr, fy, fc);
+    addchc(UIC_DEFAULT, ' ');
+  }
   if(dirlist_par) {
     mvaddchc(UIC_DEFAULT, 1, 3, ' ');
     tmp = getpath(dirlist_par);
-    mvaddstrc(UIC_DIR, 1, 4, cropstr(tmp, wincols-8));
-    mvaddchc(UIC_DEFAULT, 1, 4+((int)strlen(tmp) > wincols-8 ? wincols-8 : (int)strlen(tmp)), ' ');
+    i = fx-4 < wincols-8 ? fx-4 : wincols-8;
+    mvaddstrc(UIC_DIR, 1, 4, cropstr(tmp, i));
+    mvaddchc(UIC_DEFAULT, 1, 4+((int)strlen(tmp) > i ? i : (int)strlen(tmp)), ' ');
   }
 
   /* bottom line - stats */
   uic_set(UIC_HD);
   mvhline(winrows-1, 0, ' ', wincols);
   if(t) {
-    mvaddstr(winrows-1, 0, " Total disk usage: ");
-    printsize(UIC_HD, t->parent->size);
+    mvaddstr(winrows-1, 0, *dirlist_filter ? " Matching disk usage: " : " Total disk usage: ");
+    printsize(UIC_HD, par_size);
     addstrc(UIC_HD, "  Apparent size: ");
     uic_set(UIC_NUM_HD);
-    printsize(UIC_HD, t->parent->asize);
+    printsize(UIC_HD, par_asize);
     addstrc(UIC_HD, "  Items: ");
     uic_set(UIC_NUM_HD);
-    printw("%d", t->parent->items);
+    printw("%d", par_items);
   } else
-    mvaddstr(winrows-1, 0, " No items to display.");
+    mvaddstr(winrows-1, 0, *dirlist_filter ? " No items match the filter." : " No items to display.");
   uic_set(UIC_DEFAULT);
 
   /* nothing to display? stop here. */
-  if(!t)
+  if(!t) {
+    if(filtering)
+      move(fy, fc);
     return;
+  }
 
   /* get start position */
   t = dirlist_top(0);
 
-  /* print the list to the screen */
-  for(i=0; t && i<winrows-3; t=dirlist_next(t),i++) {
-    browse_draw_item(t, 2+i);
+  /* print the rows that differ from the previous frame */
+  for(i=0; i<drawn_rows; i++) {
+    s = t && t->flags & FF_BSEL;
+    /* the totals of the directories that are being read change every frame */
+    if(t != drawn[i] || s != (i == drawn_sel) || (dir_ui == 3 && t && t != dirlist_parent && dir_mem_scanning(dir_parent(t)) == t)) {
+      if(t)
+        browse_draw_item(t, 2+i);
+      else {
+        uic_set(UIC_DEFAULT);
+        move(2+i, 0);
+        clrtoeol();
+      }
+      drawn[i] = t;
+    }
     /* save the selected row number for later */
-    if(t->flags & FF_BSEL)
+    if(s)
       selected = i;
+    if(t)
+      t = dirlist_next(t);
   }
+  drawn_sel = selected;
+  if(selected < 0)
+    selected = 0;
+  uic_set(UIC_DEFAULT);
 
   /* draw message window */
   if(message) {
     nccreate(6, 60, "Message");
-    ncaddstr(2, 2, message);
+    ncaddstr(2, 2, cropstr(message, 56));
     ncaddstr(4, 34, "Press any key to continue");
   }
 
@@ -327,14 +421,24 @@ void browse_draw() {
   if(!message && info_show && t != dirlist_parent)
     browse_draw_info(t);
 
-  /* move cursor to selected row for accessibility */
-  move(selected+2, 0);
+  /* windows drawn over the list, here or by another screen, leave rows behind
+   * that the next frame has to overwrite */
+  if(message || info_show || pstate != ST_BROWSE)
+    full_redraw = 1;
+
+  /* move cursor to selected row for accessibility, or to the filter that is
+   * being typed */
+  if(filtering)
+    move(fy, fc);
+  else
+    move(selected+2, 0);
 }
 
 
 int browse_key(int ch) {
-  struct dir *t, *sel;
-  int i, catch = 0;
+  struct dir *t, *sel, *hl;
+  char buf[DL_FILTER_MAX+1];
+  int i, catch = 0, moved = 0;
 
   /* message window overwrites all keys */
   if(message) {
@@ -342,35 +446,80 @@ int browse_key(int ch) {
     return 0;
   }
 
+  /* typing a filter, the keys that don't edit it still work */
+  if(filtering) {
+    strcpy(buf, dirlist_filter);
+    i = strlen(buf);
+    catch++;
+    switch(ch) {
+    case 10:
+    case KEY_ENTER:
+      filtering = 0;
+      break;
+    case 27:
+      filtering = 0;
+      dirlist_set_filter("");
+      break;
+    case KEY_BACKSPACE:
+    case 127:
+    case 8:
+      /* removes the last character, not the last byte */
+      while(i > 0 && (buf[i-1] & 0xc0) == 0x80)
+        i--;
+      if(i > 0)
+        i--;
+      buf[i] = 0;
+      dirlist_set_filter(buf);
+      break;
+    default:
+      if(ch < ' ' || ch > 255 || ch == 127)
+        catch = 0;
+      else if(i < DL_FILTER_MAX) {
+        buf[i] = ch;
+        buf[i+1] = 0;
+        dirlist_set_filter(buf);
+      }
+    }
+    if(!filtering)
+      curs_set(0);
+    if(catch) {
+      full_redraw = 1;
+      return 0;
+    }
+  }
+
   sel = dirlist_get(0);
+  hl = sel ? dir_hlnk(sel) : NULL;
 
   /* info window overwrites a few keys */
   if(info_show && sel)
     switch(ch) {
     case '1':
       info_page = 0;
+      catch++;
       break;
     case '2':
-      if(sel->hlnk)
+      if(hl)
         info_page = 1;
+      catch++;
       break;
     case KEY_RIGHT:
     case 'l':
-      if(sel->hlnk) {
+      if(hl) {
         info_page = 1;
         catch++;
       }
       break;
     case KEY_LEFT:
     case 'h':
-      if(sel->hlnk) {
+      if(hl) {
         info_page = 0;
         catch++;
       }
       break;
     case KEY_UP:
     case 'k':
-      if(sel->hlnk && info_page == 1) {
+      if(hl && info_page == 1) {
         if(info_start > 0)
           info_start--;
         catch++;
@@ -379,8 +528,8 @@ int browse_key(int ch) {
     case KEY_DOWN:
     case 'j':
     case ' ':
-      if(sel->hlnk && info_page == 1) {
-        for(i=0,t=sel->hlnk; t!=sel; t=t->hlnk)
+      if(hl && info_page == 1) {
+        for(i=0,t=hl; t!=sel; t=dir_hlnk(t))
           i++;
         if(i > info_start+6)
           info_start++;
@@ -397,33 +546,46 @@ int browse_key(int ch) {
       dirlist_select(dirlist_get(-1));
       dirlist_top(-1);
       info_start = 0;
+      moved++;
       break;
     case KEY_DOWN:
     case 'j':
       dirlist_select(dirlist_get(1));
       dirlist_top(1);
       info_start = 0;
+      moved++;
       break;
     case KEY_HOME:
       dirlist_select(dirlist_next(NULL));
       dirlist_top(2);
       info_start = 0;
+      moved++;
       break;
     case KEY_LL:
     case KEY_END:
       dirlist_select(dirlist_get(1<<30));
       dirlist_top(1);
       info_start = 0;
+      moved++;
       break;
     case KEY_PPAGE:
       dirlist_select(dirlist_get(-1*(winrows-3)));
       dirlist_top(-1);
       info_start = 0;
+      moved++;
       break;
     case KEY_NPAGE:
       dirlist_select(dirlist_get(winrows-3));
       dirlist_top(1);
       info_start = 0;
+      moved++;
+      break;
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+      dirlist_select(dirlist_get_pct((ch-'0')*10));
+      dirlist_top(0);
+      info_start = 0;
+      moved++;
       break;
 
     /* sorting items */
@@ -450,6 +612,20 @@ int browse_key(int ch) {
       dirlist_set_hidden(!dirlist_hidden);
       info_show = 0;
       break;
+    case 'T':
+      dirlist_set_tree(!dirlist_tree);
+      info_show = 0;
+      break;
+    case '/':
+      filtering = 1;
+      curs_set(1);
+      info_show = 0;
+      break;
+    case 27:
+      if(*dirlist_filter)
+        dirlist_set_filter("");
+      info_show = 0;
+      break;
     case 't':
       dirlist_set_sort(DL_NOCHANGE, DL_NOCHANGE, !dirlist_sort_df);
       info_show = 0;
@@ -465,8 +641,23 @@ int browse_key(int ch) {
     case 10:
     case KEY_RIGHT:
     case 'l':
-      if(sel != NULL && sel->flags & FF_DIR) {
-        dirlist_open(sel == dirlist_parent ? dirlist_par->parent : sel);
+      if(sel != NULL && sel != dirlist_parent && sel->flags & FF_COLL && !dir_import_active) {
+        /* the contents of collapsed directories have to be read again */
+        if(dir_ui == 3) {
+          message = busy;
+          break;
+        }
+        dir_ui = 2;
+        dir_mem_init(sel);
+        dir_scan_init(getpath(sel));
+      } else if(dirlist_tree && sel != NULL && sel != dirlist_parent && sel->flags & FF_DIR) {
+        if(sel->flags & FF_EXPND)
+          dirlist_collapse(sel);
+        else
+          dirlist_expand(sel);
+        dirlist_top(0);
+      } else if(sel != NULL && sel->flags & FF_DIR) {
+        dirlist_open(sel == dirlist_parent ? dir_parent(dirlist_par) : sel);
         dirlist_top(-3);
       }
       info_show = 0;
@@ -475,8 +666,16 @@ int browse_key(int ch) {
     case KEY_BACKSPACE:
     case 'h':
     case '<':
-      if(dirlist_par && dirlist_par->parent != NULL) {
-        dirlist_open(dirlist_par->parent);
+      /* in the tree view, collapse the directory or go to the row of the
+       * directory that has the item first */
+      if(dirlist_tree && sel != NULL && sel->flags & FF_EXPND) {
+        dirlist_collapse(sel);
+        dirlist_top(0);
+      } else if(dirlist_tree && sel != NULL && dirlist_depth(sel) > 0) {
+        dirlist_select(dir_parent(sel));
+        dirlist_top(-1);
+      } else if(dirlist_par && dirlist_par->parent) {
+        dirlist_open(dir_parent(dirlist_par));
         dirlist_top(-3);
       }
       info_show = 0;
@@ -488,9 +687,12 @@ int browse_key(int ch) {
         message = "Directory imported from file, won't refresh.";
         break;
       }
+      if(dir_ui == 3) {
+        message = busy;
+        break;
+      }
       if(dirlist_par) {
-        dir_ui = 2;
-        dir_mem_init(dirlist_par);
+        dir_mem_refresh(dirlist_par);
         dir_scan_init(getpath(dirlist_par));
       }
       info_show = 0;
@@ -529,9 +731,15 @@ int browse_key(int ch) {
           : "File deletion not available for imported directories.";
         break;
       }
+      if(dir_ui == 3) {
+        message = busy;
+        break;
+      }
       if(sel == NULL || sel == dirlist_parent)
         break;
       info_show = 0;
+      /* the contents aren't shown while they're deleted */
+      dirlist_collapse(sel);
       if((t = dirlist_get(1)) == sel)
         if((t = dirlist_get(-1)) == sel || t == dirlist_parent)
           t = NULL;
@@ -544,6 +752,10 @@ int browse_key(int ch) {
           : "Shell feature not available for imported directories.";
         break;
       }
+      if(dir_ui == 3) {
+        message = busy;
+        break;
+      }
       shell_init();
       break;
     }
@@ -552,16 +764,25 @@ int browse_key(int ch) {
   sel = dirlist_get(0);
   if(!info_show || sel == dirlist_parent)
     info_show = info_page = info_start = 0;
-  else if(sel && !sel->hlnk)
+  else if(sel && !dir_hlnk(sel))
     info_page = info_start = 0;
 
+  /* anything but moving the selection may change what the rows look like */
+  if(!moved)
+    full_redraw = 1;
   return 0;
 }
 
 
+void browse_message(const char *msg) {
+  message = msg;
+}
+
+
 void browse_init(struct dir *par) {
   pstate = ST_BROWSE;
   message = NULL;
+  full_redraw = 1;
   dirlist_open(par);
 }
 
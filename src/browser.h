@@ -32,6 +32,9 @@ int  browse_key(int);
 void browse_draw(void);
 void browse_init(struct dir *);
 
+/* Shows a message window until the next key press */
+void browse_message(const char *);
+
 
 #endif
 
@@ -46,8 +46,8 @@ static void delete_draw_confirm(void) {
   nccreate(6, 60, "Confirm delete");
 
   ncprint(1, 2, "Are you sure you want to delete \"%s\"%c",
-    cropstr(root->name, 21), root->flags & FF_DIR ? ' ' : '?');
-  if(root->flags & FF_DIR && root->sub != NULL)
+    cropstr(dir_name(root), 21), root->flags & FF_DIR ? ' ' : '?');
+  if(root->flags & FF_DIR && root->sub)
     ncprint(2, 18, "and all of its contents?");
 
   if(seloption == 0)
@@ -177,22 +177,26 @@ static int delete_dir(struct dir *dr) {
 
   /* do the actual deleting */
   if(dr->flags & FF_DIR) {
-    if((r = chdir(dr->name)) < 0)
+    if((r = chdir(dir_name(dr))) < 0)
       goto delete_nxt;
-    if(dr->sub != NULL) {
-      nxt = dr->sub;
+    if(dr->sub) {
+      nxt = dir_sub(dr);
       while(nxt != NULL) {
         cur = nxt;
-        nxt = cur->next;
+        nxt = dir_next(cur);
         if(delete_dir(cur))
           return 1;
       }
     }
     if((r = chdir("..")) < 0)
       goto delete_nxt;
-    r = dr->sub == NULL ? rmdir(dr->name) : 0;
+    r = !dr->sub ? rmdir(dir_name(dr)) : 0;
+  } else if(dr->flags & FF_OTHER) {
+    /* the files that this item adds up are not known */
+    r = -1;
+    errno = ENOTSUP;
   } else
-    r = unlink(dr->name);
+    r = unlink(dir_name(dr));
 
 delete_nxt:
   /* error occurred, ask user what to do */
@@ -203,7 +207,7 @@ delete_nxt:
     while(state == DS_FAILED)
       if(input_handle(0))
         return 1;
-  } else if(!(dr->flags & FF_DIR && dr->sub != NULL)) {
+  } else if(!(dr->flags & FF_DIR && dr->sub)) {
     freedir(dr);
     return 0;
   }
@@ -218,12 +222,12 @@ void delete_process() {
   seloption = 1;
   while(state == DS_CONFIRM && !noconfirm)
     if(input_handle(0)) {
-      browse_init(root->parent);
+      browse_init(dirlist_par);
       return;
     }
 
   /* chdir */
-  if(path_chdir(getpath(root->parent)) < 0) {
+  if(path_chdir(getpath(dir_parent(root))) < 0) {
     state = DS_FAILED;
     lasterrno = errno;
     while(state == DS_FAILED)
@@ -234,11 +238,13 @@ void delete_process() {
   /* delete */
   seloption = 0;
   state = DS_PROGRESS;
-  par = root->parent;
+  par = dir_parent(root);
   delete_dir(root);
   if(nextsel)
     nextsel->flags |= FF_BSEL;
-  browse_init(par);
+  treefile_sync(getroot(par));
+  /* the item may have been in an expanded directory in the tree view */
+  browse_init(dirlist_par);
   if(nextsel)
     dirlist_top(-4);
 }
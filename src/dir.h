@@ -98,15 +98,71 @@ struct dir_output {
  */
 void dir_mem_init(struct dir *);
 
+/* Like dir_mem_init(), but the scan runs in the background of the browser,
+ * which keeps showing the old items until the new ones replace them at the
+ * end of the scan. dir_refreshing is the directory being refreshed this way,
+ * or NULL. */
+extern struct dir *dir_refreshing;
+void dir_mem_refresh(struct dir *);
+
+/* Moves the scan to the background of the browser, like dir_mem_refresh(),
+ * so that a new tree can be browsed while it's being read. Returns 0 if the
+ * output doesn't go to the browser or nothing has been read yet. With now=0
+ * it only checks whether it's possible. */
+int dir_mem_browse(int now);
+
+/* A new tree that is browsed while it's being read only has the totals of the
+ * directories that have been read completely added to their parents.
+ * dir_mem_scanning() returns the subdirectory of the given directory that is
+ * still being read, or NULL. dir_mem_live() sets the totals of the given
+ * directory including the open directories below it, and returns whether it
+ * is still being read. */
+struct dir *dir_mem_scanning(struct dir *);
+int dir_mem_live(struct dir *, int64_t *, int64_t *, int *);
+
+/* Limit in bytes on the memory used for the tree, 0 for no limit. When the
+ * tree grows near the limit, the subdirectories of each directory that has
+ * been read completely are collapsed into single FF_COLL items. */
+extern int64_t dir_mem_limit;
+
+/* Sets up a tree that has been loaded from a tree file */
+void dir_mem_reopen(struct dir *);
+
+/* Items with FF_HLNKC that refer to the same file form a circular list, which
+ * is kept in a side table in dir_mem.c. dir_hlnk() returns the next item in
+ * the list, or NULL if there's no other link. dir_hlnk_set() updates the next
+ * item, NULL removes the item from the table. */
+struct dir *dir_hlnk(struct dir *);
+void dir_hlnk_set(struct dir *, struct dir *);
+
+/* Adds the given FF_HLNKC item to (n=1) or removes it from (n=-1) the index
+ * of hard links, which is kept for as long as the tree exists: its circular
+ * list and the number of links to its file in each of its parent directories.
+ * Returns the first parent directory in which the file is (or was already)
+ * counted through another link, or NULL. The file has to be added to or
+ * removed from the size of the directories below that one. */
+struct dir *dir_hlnk_update(struct dir *, int);
+
 /* Initializes the SCAN state and dir_output for exporting to a file. */
 int dir_export_init(const char *fn);
 
 
+/* Summarizing the output: items deeper than dir_max_depth (-1 for no limit)
+ * and files smaller than dir_min_size are not passed on to dir_output, but
+ * added up into a single "<other>" item in their closest remaining parent.
+ * Called by the output code after setting up dir_output, with the depth of the
+ * directory that is going to be read. */
+extern int dir_max_depth;
+extern int64_t dir_min_size;
+void dir_summary_init(int);
+
+
 /* Function set by input code. Returns dir_output.final(). */
 extern int (*dir_process)(void);
 
 /* Scanning a live directory */
 extern int dir_scan_smfs;
+extern long dir_scan_budget;
 void dir_scan_init(const char *path);
 
 /* Importing a file */
@@ -134,6 +190,8 @@ void dir_setlasterr(const char *);
 extern char *dir_fatalerr;
 void dir_seterr(const char *, ...);
 
+/* 0 = no UI, 1 = single line, 2 = full ncurses, 3 = refreshing in the
+ * background while browsing */
 extern int dir_ui;
 int dir_key(int);
 void dir_draw(void);
@@ -104,6 +104,13 @@ void dir_seterr(const char *fmt, ...) {
   vsnprintf(dir_fatalerr, 1023, fmt, va);
   dir_fatalerr[1023] = 0;
   va_end(va);
+
+  /* a new tree that is read in the background of the browser can't be
+   * browsed after an error, show the error window instead */
+  if(dir_ui == 3 && !dir_refreshing) {
+    dir_ui = 2;
+    pstate = ST_CALC;
+  }
 }
 
 
@@ -129,6 +136,11 @@ static void draw_progress(void) {
 
   uic_set(UIC_DEFAULT);
   ncprint(3, 2, "Current item: %s", cropstr(dir_curpath, width-18));
+  if(dir_mem_browse(0)) {
+    ncaddstr(7, width-19, "Press ");
+    addchc(UIC_KEY, 'b');
+    addstrc(UIC_DEFAULT, " to browse");
+  }
   if(confirm_quit_while_scanning_stage_1_passed) {
     ncaddstr(8, width-26, "Press ");
     addchc(UIC_KEY, 'y');
@@ -214,6 +226,10 @@ void dir_draw() {
 int dir_key(int ch) {
   if(dir_fatalerr)
     return 1;
+  if(ch == 'b' && dir_mem_browse(1)) {
+    confirm_quit_while_scanning_stage_1_passed = 0;
+    return 0;
+  }
   if(confirm_quit && confirm_quit_while_scanning_stage_1_passed) {
     if (ch == 'y'|| ch == 'Y') {
       return 1;
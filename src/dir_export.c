@@ -115,6 +115,8 @@ static void output_info(struct dir *d, const char *name, struct dir_ext *e) {
     fputs(",\"hlnkc\":true", stream);
   if(d->flags & FF_ERR)
     fputs(",\"read_error\":true", stream);
+  if(d->flags & FF_INC)
+    fputs(",\"incomplete\":true", stream);
   /* excluded/error'd files are "unknown" with respect to the "notreg" field. */
   if(!(d->flags & (FF_DIR|FF_FILE|FF_ERR|FF_EXL|FF_OTHFS|FF_KERNFS|FF_FRMLNK)))
     fputs(",\"notreg\":true", stream);
@@ -189,6 +191,7 @@ int dir_export_init(const char *fn) {
   dir_output.final = final;
   dir_output.size = 0;
   dir_output.items = 0;
+  dir_summary_init(0);
   return 0;
 }
 
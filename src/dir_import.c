@@ -476,6 +476,12 @@ static int iteminfo(void) {
         ctx->buf_dir->flags |= FF_ERR;
       } else
         C(rlit("false", 5));
+    } else if(strcmp(ctx->val, "incomplete") == 0) { /* incomplete */
+      if(*ctx->buf == 't') {
+        C(rlit("true", 4));
+        ctx->buf_dir->flags |= FF_INC;
+      } else
+        C(rlit("false", 5));
     } else if(strcmp(ctx->val, "excluded") == 0) {   /* excluded */
       C(rstring(ctx->val, 8));
       if(strcmp(ctx->val, "otherfs") == 0)
@@ -505,11 +511,7 @@ static int iteminfo(void) {
 
   E(!*ctx->buf_name, "No name field present in item information object");
   ctx->items++;
-  /* Only call input_handle() once for every 32 items. Importing items is so
-   * fast that the time spent in input_handle() dominates when called every
-   * time. Don't set this value too high, either, as feedback should still be
-   * somewhat responsive when our import data comes from a slow-ish source. */
-  return !(ctx->items & 31) ? input_handle(1) : 0;
+  return input_handle(1);
 }
 
 
@@ -524,7 +526,7 @@ static int item(uint64_t dev) {
     C(cons());
   }
 
-  memset(ctx->buf_dir, 0, offsetof(struct dir, name));
+  memset(ctx->buf_dir, 0, sizeof(struct dir));
   memset(ctx->buf_ext, 0, sizeof(struct dir_ext));
   *ctx->buf_name = 0;
   ctx->buf_dir->flags |= isdir ? FF_DIR : FF_FILE;
@@ -604,7 +606,7 @@ int dir_import_init(const char *fn) {
   ctx->line = 1;
   ctx->byte = ctx->eof = ctx->items = 0;
   ctx->buf = ctx->lastfill = ctx->readbuf;
-  ctx->buf_dir = xmalloc(dir_memsize(""));
+  ctx->buf_dir = xmalloc(sizeof(struct dir));
   ctx->readbuf[0] = 0;
 
   dir_curpath_set(fn);
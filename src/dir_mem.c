@@ -34,59 +34,303 @@
 static struct dir *root;   /* root directory struct we're scanning */
 static struct dir *curdir; /* directory item that we're currently adding items to */
 static struct dir *orig;   /* original directory, when refreshing an already scanned dir */
+static struct arena *arena; /* arena to allocate the new items from */
+
+int64_t dir_mem_limit;
+struct dir *dir_refreshing;
+
+/* Side table with the circular lists of hard links: maps each item that shares
+ * its file with other items to the next one. This is kept around for as long
+ * as there are items in it. */
+KHASHL_MAP_INIT(KH_LOCAL, hn_t, hn, uint32_t, uint32_t, kh_hash_uint32, kh_eq_generic)
+static hn_t *hlnks = NULL;
+
+/* Index of the FF_HLNKC items in the tree, kept for the lifetime of the tree
+ * and updated as items are added and removed. hlids maps each file to a
+ * number, its number of links in the tree and one of those links.
+ * hlcnt holds the number of links to each file within every directory, a
+ * file is counted in the size of each directory that has at least one link to
+ * it. Its keys are the reference of the directory and the number of the file.
+ * Entries are removed when they drop to zero. */
+struct hlid {
+  uint64_t dev, ino;
+};
+struct hlidval {
+  uint32_t id, links, item;
+};
+#define hlid_hash(k)     (kh_hash_uint64((khint64_t)(k).dev) ^ kh_hash_uint64((khint64_t)(k).ino))
+#define hlid_equal(a, b) ((a).dev == (b).dev && (a).ino == (b).ino)
+KHASHL_MAP_INIT(KH_LOCAL, hi_t, hi, struct hlid, struct hlidval, hlid_hash, hlid_equal)
+KHASHL_MAP_INIT(KH_LOCAL, hc_t, hc, uint64_t, uint32_t, kh_hash_uint64, kh_eq_generic)
+static hi_t *hlids = NULL;
+static hc_t *hlcnt = NULL;
+static uint32_t hlid_next;
+
+/* Directories of the current scan that contain hard links somewhere in their
+ * subtree and thus can't be collapsed. A directory is added when a hard link
+ * is put in it or when one of its subdirectories in the set is finished, so
+ * collapse() never has to look through a subtree again. Only used with a
+ * memory limit, and dropped when the scan is done. */
+KHASHL_SET_INIT(KH_LOCAL, hp_t, hp, uint32_t, kh_hash_uint32, kh_eq_generic)
+static hp_t *pinned = NULL;
+static int collapsing;
+
+
+struct dir *dir_hlnk(struct dir *d) {
+  khint_t k;
+
+  if(!hlnks || !(d->flags & FF_HLNKC))
+    return NULL;
+  k = hn_get(hlnks, dir_ref(d));
+  return k == kh_end(hlnks) ? NULL : dir_ptr(kh_val(hlnks, k));
+}
+
+
+void dir_hlnk_set(struct dir *d, struct dir *next) {
+  khint_t k;
+  int absent;
+
+  if(next) {
+    if(!hlnks)
+      hlnks = hn_init();
+    k = hn_put(hlnks, dir_ref(d), &absent);
+    kh_val(hlnks, k) = dir_ref(next);
+  } else if(hlnks && (k = hn_get(hlnks, dir_ref(d))) != kh_end(hlnks)) {
+    hn_del(hlnks, k);
+    if(!kh_size(hlnks)) {
+      hn_destroy(hlnks);
+      hlnks = NULL;
+    }
+  }
+}
+
+
+struct dir *dir_hlnk_update(struct dir *d, int n) {
+  struct dir *par, *top = NULL, *t, *hl;
+  struct hlid h;
+  khint_t k;
+  uint32_t id;
+  int absent;
+
+  if(!hlids) {
+    hlids = hi_init();
+    hlcnt = hc_init();
+  }
+  h.dev = d->dev;
+  h.ino = d->ino;
+  k = hi_put(hlids, h, &absent);
+  if(absent) {
+    kh_val(hlids, k).id = hlid_next++;
+    kh_val(hlids, k).links = 0;
+    kh_val(hlids, k).item = dir_ref(d);
+  }
+  id = kh_val(hlids, k).id;
+  hl = dir_hlnk(d);
+
+  /* add to or remove from the list of links */
+  if(n > 0 && !absent) {
+    t = dir_ptr(kh_val(hlids, k).item);
+    hl = dir_hlnk(t);
+    dir_hlnk_set(d, hl ? hl : t);
+    dir_hlnk_set(t, d);
+  } else if(n < 0 && hl) {
+    for(t=hl; dir_hlnk(t)!=d; t=dir_hlnk(t))
+      ;
+    dir_hlnk_set(t, hl);
+    dir_hlnk_set(d, NULL);
+    if(kh_val(hlids, k).item == dir_ref(d))
+      kh_val(hlids, k).item = dir_ref(hl);
+  }
 
-/* Table of struct dir items with more than one link (in order to detect hard links) */
-#define hlink_hash(d)     (kh_hash_uint64((khint64_t)d->dev) ^ kh_hash_uint64((khint64_t)d->ino))
-#define hlink_equal(a, b) ((a)->dev == (b)->dev && (a)->ino == (b)->ino)
-KHASHL_SET_INIT(KH_LOCAL, hl_t, hl, struct dir *, hlink_hash, hlink_equal)
-static hl_t *links = NULL;
+  if(!(kh_val(hlids, k).links += n))
+    hi_del(hlids, k);
+
+  for(par=dir_parent(d); par; par=dir_parent(par)) {
+    k = hc_put(hlcnt, (uint64_t)dir_ref(par)<<32 | id, &absent);
+    if(absent)
+      kh_val(hlcnt, k) = 0;
+    kh_val(hlcnt, k) += n;
+    if(!top && kh_val(hlcnt, k) != (n > 0 ? 1 : 0))
+      top = par;
+    if(!kh_val(hlcnt, k))
+      hc_del(hlcnt, k);
+  }
+  return top;
+}
+
+
+/* adds an individual file to the index of hard links and updates the sizes of
+ * the parent dirs. Returns whether the file has been counted in the root
+ * item. */
+static int hlink_check(struct dir *d) {
+  struct dir *t, *par;
+  int above;
+
+  /* now find the parent directories in which this file hasn't been counted
+   * yet. These form a chain starting at the parent, the file is added to the
+   * parent and subtracted again from the first directory after the chain, so
+   * that it ends up in just the directories of the chain when they are
+   * closed. */
+  par = dir_hlnk_update(d, 1);
+  for(above=0, t=dir_parent(d); t!=par; t=dir_parent(t))
+    if(t == root)
+      above = 1;
+  if(par == dir_parent(d))
+    return 0;
+
+  t = dir_parent(d);
+  t->size = adds64(t->size, d->size);
+  t->asize = adds64(t->asize, d->asize);
+  /* The parents of the root item have already been closed */
+  if(par && above)
+    addparentstats(par, -d->size, -d->asize, 0, 0);
+  else if(par) {
+    par->size = adds64(par->size, -d->size);
+    par->asize = adds64(par->asize, -d->asize);
+  }
+  return above;
+}
 
 
-/* recursively checks a dir structure for hard links and fills the lookup array */
-static void hlink_init(struct dir *d) {
+/* Restores the state that isn't kept in a tree file after reopening it: the
+ * number of (hard link) items and the memory used in the arena, and the index
+ * of hard links. */
+static void reopen_rec(struct dir *d) {
+  struct arena *a = arena_of(d);
+  size_t size = (dir_item_memsize(d->flags, d->ext) + 7) & ~(size_t)7;
   struct dir *t;
 
-  for(t=d->sub; t!=NULL; t=t->next)
-    hlink_init(t);
+  a->nodes++;
+  a->used += size;
+  arena_used += size;
+  for(t=dir_sub(d); t!=NULL; t=dir_next(t))
+    reopen_rec(t);
 
   if(!(d->flags & FF_HLNKC))
     return;
-  int r;
-  hl_put(links, d, &r);
+  a->hlnkc++;
+  dir_hlnk_update(d, 1);
 }
 
 
-/* checks an individual file for hard links and updates its cicrular linked
- * list, also updates the sizes of the parent dirs */
-static void hlink_check(struct dir *d) {
-  struct dir *t, *pt, *par;
-  int i;
+void dir_mem_reopen(struct dir *root) {
+  reopen_rec(root);
+  arena_of(root)->owner = root;
+}
+
+
+/* Clears the INC flag of the parent directories of *d when none of their
+ * (direct) subdirectories are incomplete anymore, e.g. after refreshing an
+ * incomplete directory with enough time to finish it. */
+static void inc_fixup(struct dir *d) {
+  struct dir *par, *t;
+
+  for(par=dir_parent(d); par && par->flags & FF_INC; par=dir_parent(par)) {
+    for(t=dir_sub(par); t; t=dir_next(t))
+      if(t->flags & FF_INC)
+        return;
+    par->flags &= ~FF_INC;
+  }
+}
+
+
+static void pin(struct dir *d) {
+  int absent;
+  if(!pinned)
+    pinned = hp_init();
+  hp_put(pinned, dir_ref(d), &absent);
+}
+
+
+static int is_pinned(struct dir *d) {
+  return pinned && hp_get(pinned, dir_ref(d)) != kh_end(pinned);
+}
+
+
+static void collapse_free(struct dir *d) {
+  struct dir *n;
+  for(; d; d=n) {
+    n = dir_next(d);
+    if(d->sub)
+      collapse_free(dir_sub(d));
+    dirlist_free(d);
+    arena_free(d, dir_item_memsize(d->flags, d->ext));
+  }
+}
+
+
+static int collapse_cmp(const void *va, const void *vb) {
+  const struct dir *a = *(struct dir * const *)va, *b = *(struct dir * const *)vb;
+  return a->items > b->items ? -1 : a->items < b->items ? 1 : 0;
+}
+
+
+/* Drops the contents of the subdirectories of *d, which has just been read
+ * completely, until the tree uses at most 3/4th of the memory limit. The
+ * subdirectories keep their size, item count and mtime and can be scanned
+ * again from the browser. The subdirectories with the most items go first, and
+ * as directories are finished bottom-up the deepest directories are collapsed
+ * before their parents, which keeps the most interesting part of the tree.
+ * Directories with hard links in them, the subdirectory with the directory
+ * that is opened in the browser and those that are expanded in its tree view
+ * are kept. */
+static void collapse(struct dir *d) {
+  static struct dir **list = NULL;
+  static int listsize = 0;
+  struct dir *t, *b;
+  int i, n = 0;
+
+  if(!(collapsing = arena_used > dir_mem_limit - dir_mem_limit/4))
+    return;
+  for(b=dirlist_par; b && dir_parent(b) != d; b=dir_parent(b))
+    ;
+  for(t=dir_sub(d); t; t=dir_next(t))
+    if(t != b && !(dirlist_tree && t->flags & FF_EXPND) && t->flags & FF_DIR && t->sub
+        && arena_of(t) == arena && !is_pinned(t)) {
+      if(n == listsize)
+        list = xrealloc(list, (listsize = listsize ? listsize*2 : 64) * sizeof(*list));
+      list[n++] = t;
+    }
+  if(n > 1)
+    qsort(list, n, sizeof(*list), collapse_cmp);
+
+  for(i=0; i<n && collapsing; i++) {
+    collapse_free(dir_sub(list[i]));
+    list[i]->sub = 0;
+    list[i]->flags |= FF_COLL;
+    collapsing = arena_used > dir_mem_limit - dir_mem_limit/4;
+  }
+}
+
+
+/* Adds the stats of *d to its parent directory. The totals of a directory are
+ * only added after it has been read completely, so every item is added to a
+ * single parent rather than to all the directories up to the root. The
+ * parents of the root item are already complete when refreshing, so those are
+ * all updated at once. The size of hard links is handled by hlink_check(). */
+static void add_stats(struct dir *d) {
+  struct dir *par = dir_parent(d);
+  uint64_t *m, mtime;
+  int flags = (d->flags & (FF_ERR|FF_SERR) ? FF_SERR : 0) | (d->flags & FF_INC);
+
+  if(d == root) {
+    addparentstats(par, d->size, d->asize, d->flags & FF_EXT ? dir_mtime(d) : 0, d->items+1);
+    for(; par && flags; par=dir_parent(par))
+      par->flags |= flags;
+    return;
+  }
 
-  /* add to links table */
-  khint_t k = hl_put(links, d, &i);
-
-  /* found in the table? update hlnk */
-  if(!i) {
-    t = kh_key(links, k);
-    d->hlnk = t->hlnk == NULL ? t : t->hlnk;
-    t->hlnk = d;
-  }
-
-  /* now update the sizes of the parent directories,
-   * This works by only counting this file in the parent directories where this
-   * file hasn't been counted yet, which can be determined from the hlnk list.
-   * XXX: This may not be the most efficient algorithm to do this */
-  for(i=1,par=d->parent; i&&par; par=par->parent) {
-    if(d->hlnk)
-      for(t=d->hlnk; i&&t!=d; t=t->hlnk)
-        for(pt=t->parent; i&&pt; pt=pt->parent)
-          if(pt==par)
-            i=0;
-    if(i) {
-      par->size = adds64(par->size, d->size);
-      par->asize = adds64(par->asize, d->asize);
+  if(!(d->flags & FF_HLNKC)) {
+    par->size = adds64(par->size, d->size);
+    par->asize = adds64(par->asize, d->asize);
+    if(par->flags & FF_EXT && d->flags & FF_EXT) {
+      m = dir_mtime_ptr(par);
+      mtime = dir_mtime(d);
+      *m = *m > mtime ? *m : mtime;
     }
   }
+  par->items += d->items+1;
+  par->flags |= flags;
 }
 
 
@@ -100,116 +344,295 @@ static void item_add(struct dir *item) {
     if(orig)
       root->parent = orig->parent;
   } else {
-    item->parent = curdir;
+    item->parent = dir_ref(curdir);
     item->next = curdir->sub;
-    if(item->next)
-      item->next->prev = item;
-    curdir->sub = item;
+    curdir->sub = dir_ref(item);
+    /* the directory may have been opened in the browser already */
+    if(curdir->flags & FF_SORTED)
+      dirlist_changed(curdir);
   }
 }
 
 
 static int item(struct dir *dir, const char *name, struct dir_ext *ext) {
-  struct dir *t, *item;
+  struct dir *item;
 
-  /* Go back to parent dir */
+  /* Go back to parent dir, start collapsing directories at 7/8th of the
+   * memory limit to leave some room for the directories that are still being
+   * read, and keep going until the tree is down to 3/4th. Only the tree is
+   * counted: the name pool can't shrink, so counting it would collapse
+   * everything once the names alone get close to the limit. */
   if(!dir) {
-    curdir = curdir->parent;
+    if(dir_mem_limit && (collapsing || arena_used > dir_mem_limit - dir_mem_limit/8))
+      collapse(curdir);
+    if(is_pinned(curdir) && curdir != root)
+      pin(dir_parent(curdir));
+    add_stats(curdir);
+    curdir = dir_parent(curdir);
+    if(curdir && curdir->flags & FF_SORTED)
+      dirlist_changed(curdir);
     return 0;
   }
 
   if(!root && orig)
-    name = orig->name;
+    name = dir_name(orig);
+
+  /* Special-case the name of the root item to be empty instead of "/". This is
+   * what getpath() expects. */
+  if(!root && strcmp(name, "/") == 0)
+    name = "";
 
   if(!extended_info)
     dir->flags &= ~FF_EXT;
-  item = xmalloc(dir->flags & FF_EXT ? dir_ext_memsize(name) : dir_memsize(name));
-  memcpy(item, dir, offsetof(struct dir, name));
-  strcpy(item->name, name);
+  dir->ext = dir->flags & FF_EXT ? dir_ext_intern(ext) : 0;
+  item = arena_alloc(arena, dir_item_memsize(dir->flags, dir->ext));
+  memcpy(item, dir, sizeof(struct dir));
+  item->name = name_intern(name);
   if(dir->flags & FF_EXT)
-    memcpy(dir_ext_ptr(item), ext, sizeof(struct dir_ext));
+    dir_ext_set(item, ext);
 
   item_add(item);
+  if(item == root)
+    arena->owner = item;
 
   /* Ensure that any next items will go to this directory */
   if(item->flags & FF_DIR)
     curdir = item;
 
-  /* Special-case the name of the root item to be empty instead of "/". This is
-   * what getpath() expects. */
-  if(item == root && strcmp(item->name, "/") == 0)
-    item->name[0] = 0;
-
-  /* Update stats of parents. Don't update the size/asize fields if this is a
-   * possible hard link, because hlnk_check() will take care of it in that
-   * case. */
+  /* Update stats of the parent, directories are added when they are closed.
+   * Don't update the size/asize fields if this is a possible hard link,
+   * because hlnk_check() will take care of it in that case. */
+  if(item != root)
+    dir_output.items += item->items+1;
   if(item->flags & FF_HLNKC) {
-    addparentstats(item->parent, 0, 0, 0, 1);
-    hlink_check(item);
-  } else if(item->flags & FF_EXT) {
-    addparentstats(item->parent, item->size, item->asize, dir_ext_ptr(item)->mtime, 1);
+    arena->hlnkc++;
+    if(dir_mem_limit && item != root)
+      pin(dir_parent(item));
+    add_stats(item);
+    if(hlink_check(item))
+      dir_output.size = adds64(dir_output.size, item->size);
   } else {
-    addparentstats(item->parent, item->size, item->asize, 0, 1);
+    if(!(item->flags & FF_DIR))
+      add_stats(item);
+    dir_output.size = adds64(dir_output.size, item->size);
   }
 
-  /* propagate ERR and SERR back up to the root */
-  if(item->flags & FF_SERR || item->flags & FF_ERR)
-    for(t=item->parent; t; t=t->parent)
-      t->flags |= FF_SERR;
+  return 0;
+}
+
+
+struct dir *dir_mem_scanning(struct dir *d) {
+  struct dir *t;
+
+  if(dir_ui != 3 || orig || !d)
+    return NULL;
+  for(t=curdir; t; t=dir_parent(t))
+    if(t->parent == dir_ref(d))
+      return t;
+  return NULL;
+}
 
-  dir_output.size = root->size;
-  dir_output.items = root->items;
 
+int dir_mem_live(struct dir *d, int64_t *size, int64_t *asize, int *items) {
+  struct dir *t;
+  int64_t s = d->size, as = d->asize;
+  int n = d->items;
+
+  if(dir_ui == 3 && !orig) {
+    /* add the directories below *d that haven't been added to it yet */
+    for(t=curdir; t && t != d; t=dir_parent(t)) {
+      s = adds64(s, t->size);
+      as = adds64(as, t->asize);
+      n += t->items+1;
+    }
+    if(t) {
+      *size = s;
+      *asize = as;
+      *items = n;
+      return 1;
+    }
+  }
+  *size = d->size;
+  *asize = d->asize;
+  *items = d->items;
   return 0;
 }
 
 
+/* Returns the item in the new tree with the same path as *d, which is in the
+ * tree of *orig, or its closest parent that still exists. */
+static struct dir *remap(struct dir *d) {
+  struct dir *par, *t;
+
+  if(d == orig)
+    return root;
+  par = remap(dir_parent(d));
+  /* an unchanged name is usually interned only once, so the references are
+   * compared before any name is decoded */
+  for(t=dir_sub(par); t; t=dir_next(t))
+    if(t->name == d->name)
+      return t;
+  for(t=dir_sub(par); t; t=dir_next(t))
+    if(strcmp(dir_name(t), dir_name(d)) == 0)
+      return t;
+  return par;
+}
+
+
+/* Opens the directory that was being browsed during a background refresh
+ * again, or the same directory in the new tree if it was inside the refreshed
+ * one. Called before *orig is freed. */
+static struct dir *reopen_browser(void) {
+  struct dir *t, *par, *sel = dirlist_get(0);
+
+  /* the directories that are expanded in the tree view stay expanded */
+  for(t=dirlist_tree ? dirlist_next(NULL) : NULL; t; t=dirlist_next(t)) {
+    if(!(t->flags & FF_EXPND) || t == orig)
+      continue;
+    for(par=dir_parent(t); par && par != orig; par=dir_parent(par))
+      ;
+    if(!par)
+      continue;
+    /* remap() decodes other names, so look at this one afterwards */
+    par = remap(t);
+    if(par->name == t->name || strcmp(dir_name(par), dir_name(t)) == 0)
+      par->flags |= FF_EXPND;
+  }
+
+  for(t=dirlist_par; t && t != orig; t=dir_parent(t))
+    ;
+  if(!t)
+    return dirlist_par;
+
+  par = remap(dirlist_par);
+  if(sel && sel != dirlist_parent && (t = remap(sel)) != par)
+    t->flags |= FF_BSEL;
+  for(; !(par->flags & FF_DIR); par=dir_parent(par))
+    ;
+  return par;
+}
+
+
 static int final(int fail) {
-  hl_destroy(links);
-  links = NULL;
+  struct dir *par, *t, *open = NULL;
+  char filter[DL_FILTER_MAX+1] = "";
+  int bg = dir_ui == 3;
+
+  if(bg) {
+    dir_ui = 2;
+    dir_refreshing = NULL;
+  }
+  if(pinned) {
+    hp_destroy(pinned);
+    pinned = NULL;
+  }
+  collapsing = 0;
 
   if(fail) {
-    freedir(root);
-    if(orig) {
+    /* add up the directories that are still open, freedir() takes their
+     * totals out of the parents of the root again */
+    for(; root && curdir && curdir != dir_parent(root); curdir=dir_parent(curdir))
+      add_stats(curdir);
+    if(root)
+      freedir(root);
+    else
+      arena_destroy(arena);
+    /* a background refresh is only aborted on an error or when quitting */
+    if(bg && dir_fatalerr)
+      browse_message(dir_fatalerr);
+    else if(orig && !bg)
       browse_init(orig);
-      return 0;
-    } else
+    else
       return 1;
+    return 0;
   }
 
   /* success, update references and free original item */
+  if(bg && !orig)
+    open = dirlist_par;
+  /* the filter stays when the directory that is browsed has been refreshed */
+  if(orig && orig == dirlist_par)
+    strcpy(filter, dirlist_filter);
   if(orig) {
+    if(bg)
+      open = reopen_browser();
+    root->flags |= orig->flags & (FF_BSEL|FF_EXPND);
     root->next = orig->next;
-    root->prev = orig->prev;
-    if(root->parent && root->parent->sub == orig)
-      root->parent->sub = root;
-    if(root->prev)
-      root->prev->next = root;
-    if(root->next)
-      root->next->prev = root;
-    orig->next = orig->prev = NULL;
+    if((par = dir_parent(root)) && par->sub == dir_ref(orig))
+      par->sub = dir_ref(root);
+    else if(par) {
+      for(t=dir_sub(par); t->next != dir_ref(orig); t=dir_next(t))
+        ;
+      t->next = dir_ref(root);
+    }
+    orig->next = 0;
     freedir(orig);
+    if(!(root->flags & FF_INC))
+      inc_fixup(root);
+  }
+  treefile_sync(getroot(root));
+
+  /* the old listing of the parent may still refer to *orig */
+  if(bg) {
+    par = dirlist_par;
+    dirlist_open(open);
+    if(*filter)
+      dirlist_set_filter(filter);
+    dirlist_top(open != par || open == dir_parent(root) ? -3 : 0);
+  } else {
+    browse_init(root);
+    if(*filter)
+      dirlist_set_filter(filter);
+    dirlist_top(-3);
   }
-
-  browse_init(root);
-  dirlist_top(-3);
   return 0;
 }
 
 
 void dir_mem_init(struct dir *_orig) {
+  struct dir *t;
+  int i;
+
   orig = _orig;
   root = curdir = NULL;
   pstate = ST_CALC;
 
+  /* The new items go into a fresh arena, which is nested in the arena of the
+   * closest parent directory that owns one */
+  for(t=orig ? dir_parent(orig) : NULL; t && arena_of(t)->owner != t; t=dir_parent(t))
+    ;
+  arena = arena_create(t ? arena_of(t) : NULL);
+
   dir_output.item = item;
   dir_output.final = final;
   dir_output.size = 0;
   dir_output.items = 0;
+  for(i=0, t=orig; t && (t=dir_parent(t)); i++)
+    ;
+  dir_summary_init(i);
+}
+
 
-  /* Init hash table for hard link detection */
-  links = hl_init();
-  if(orig)
-    hlink_init(getroot(orig));
+int dir_mem_browse(int now) {
+  if(dir_output.final != final || !root || dir_ui != 2)
+    return 0;
+  if(!now)
+    return 1;
+  dir_ui = 3;
+  if(orig) {
+    dir_refreshing = orig;
+    pstate = ST_BROWSE;
+  } else {
+    browse_init(root);
+    dirlist_top(-3);
+  }
+  return 1;
 }
 
+
+void dir_mem_refresh(struct dir *d) {
+  dir_mem_init(d);
+  dir_refreshing = d;
+  dir_ui = 3;
+  pstate = ST_BROWSE;
+}
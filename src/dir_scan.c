@@ -28,6 +28,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -51,8 +52,10 @@
 
 
 int dir_scan_smfs; /* Stay on the same filesystem */
+long dir_scan_budget; /* Max. number of seconds to spend scanning, 0 for no limit */
 
 static uint64_t curdev;   /* current device we're scanning on */
+static time_t scanstart;  /* time at which the scan has started */
 
 /* scratch space */
 static struct dir    *buf_dir;
@@ -304,8 +307,15 @@ static int dir_scan_item(const char *name) {
       buf_dir->size = buf_dir->asize = 0;
     }
 
+  /* Don't descend into any more directories once the time budget has run out,
+   * the remaining items in the directories that are already open are still
+   * added so that the sizes of those are at least somewhat accurate. */
+  if(dir_scan_budget && (buf_dir->flags & FF_DIR) && !(buf_dir->flags & (FF_ERR|FF_EXL|FF_OTHFS|FF_KERNFS|FF_FRMLNK))
+      && time(NULL) - scanstart >= dir_scan_budget)
+    buf_dir->flags |= FF_INC;
+
   /* Recurse into the dir or output the item */
-  if(buf_dir->flags & FF_DIR && !(buf_dir->flags & (FF_ERR|FF_EXL|FF_OTHFS|FF_KERNFS|FF_FRMLNK)))
+  if(buf_dir->flags & FF_DIR && !(buf_dir->flags & (FF_ERR|FF_EXL|FF_OTHFS|FF_KERNFS|FF_FRMLNK|FF_INC)))
     fail = dir_scan_recurse(name);
   else if(buf_dir->flags & FF_DIR) {
     if(dir_output.item(buf_dir, name, buf_ext) || dir_output.item(NULL, 0, NULL)) {
@@ -331,7 +341,7 @@ static int dir_walk(char *dir) {
   fail = 0;
   for(cur=dir; !fail&&cur&&*cur; cur+=strlen(cur)+1) {
     dir_curpath_enter(cur);
-    memset(buf_dir, 0, offsetof(struct dir, name));
+    memset(buf_dir, 0, sizeof(struct dir));
     memset(buf_ext, 0, sizeof(struct dir_ext));
     fail = dir_scan_item(cur);
     dir_curpath_leave();
@@ -348,7 +358,8 @@ static int process(void) {
   int fail = 0;
   struct stat fs;
 
-  memset(buf_dir, 0, offsetof(struct dir, name));
+  scanstart = time(NULL);
+  memset(buf_dir, 0, sizeof(struct dir));
   memset(buf_ext, 0, sizeof(struct dir_ext));
 
   if((path = path_real(dir_curpath)) == NULL)
@@ -388,7 +399,8 @@ static int process(void) {
     }
   }
 
-  while(dir_fatalerr && !input_handle(0))
+  /* errors of a background refresh are shown by the browser */
+  while(dir_fatalerr && dir_ui != 3 && !input_handle(0))
     ;
   return dir_output.final(dir_fatalerr || fail);
 }
@@ -400,6 +412,5 @@ void dir_scan_init(const char *path) {
   dir_seterr(NULL);
   dir_process = process;
   if (!buf_dir)
-    buf_dir = xmalloc(dir_memsize(""));
-  pstate = ST_CALC;
+    buf_dir = xmalloc(sizeof(struct dir));
 }
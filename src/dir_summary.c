@@ -0,0 +1,165 @@
+/* ncdu - NCurses Disk Usage
+
+  Copyright (c) 2020 Yoran Heling
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "global.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <khashl.h>
+
+
+int dir_max_depth = -1;
+int64_t dir_min_size;
+
+/* Directories that are currently open. The first 'kept' of them have been
+ * passed on to the actual output, the ones after that have been pruned. */
+struct level {
+  uint64_t dev;
+  struct dir other;   /* sizes and flags of the pruned items in this dir */
+  uint64_t mtime;
+  uint32_t id;        /* unique number of a kept dir */
+};
+
+/* Files with several hard links that have been pruned, mapped to the id of the
+ * kept directory they were last passed on to. Such a file can't be added up
+ * into "<other>", because the output counts it only once in each directory
+ * that has a link to it, so it's passed on as an "<other>" item of its own,
+ * once for every kept directory it's pruned in. */
+struct hlnk {
+  uint64_t dev, ino;
+};
+#define hlnk_hash(k)     (kh_hash_uint64((khint64_t)(k).dev) ^ kh_hash_uint64((khint64_t)(k).ino))
+#define hlnk_equal(a, b) ((a).dev == (b).dev && (a).ino == (b).ino)
+KHASHL_MAP_INIT(KH_LOCAL, hs_t, hs, struct hlnk, uint32_t, hlnk_hash, hlnk_equal)
+static hs_t *links;
+
+static struct level *levels;
+static int levelsl, depth, kept, base;
+static uint32_t lastid;
+static int (*output_item)(struct dir *, const char *, struct dir_ext *);
+
+
+static void push(uint64_t dev) {
+  if(depth == levelsl) {
+    levelsl = levelsl ? levelsl*2 : 16;
+    levels = xrealloc(levels, levelsl*sizeof(*levels));
+  }
+  memset(&levels[depth], 0, sizeof(*levels));
+  levels[depth++].dev = dev;
+}
+
+
+static void prune(struct dir *d, struct dir_ext *e) {
+  struct level *l = &levels[kept-1];
+
+  l->other.items++;
+  l->other.size = adds64(l->other.size, d->size);
+  l->other.asize = adds64(l->other.asize, d->asize);
+  l->other.flags |= d->flags & (FF_ERR|FF_INC);
+  if(d->flags & FF_EXT && e->mtime > l->mtime)
+    l->mtime = e->mtime;
+}
+
+
+static int prune_hlnk(struct dir *d, struct dir_ext *e) {
+  struct level *l = &levels[kept-1];
+  struct dir hd;
+  struct hlnk h;
+  khint_t k;
+  int absent;
+
+  h.dev = d->dev;
+  h.ino = d->ino;
+  k = hs_put(links, h, &absent);
+  if(!absent && kh_val(links, k) == l->id) {
+    l->other.items++;
+    return 0;
+  }
+  kh_val(links, k) = l->id;
+  hd = *d;
+  hd.flags |= FF_OTHER;
+  return output_item(&hd, "<other>", e);
+}
+
+
+/* Passes the totals of the pruned items in the directory that is being closed
+ * on to the output as a single "<other>" file. */
+static int other(struct level *l) {
+  struct dir_ext e;
+
+  if(!l->other.items)
+    return 0;
+  l->other.flags |= FF_FILE|FF_OTHER;
+  l->other.dev = l->dev;
+  /* the item itself is counted by the output */
+  l->other.items--;
+  memset(&e, 0, sizeof(e));
+  if(extended_info) {
+    l->other.flags |= FF_EXT;
+    e.mtime = l->mtime;
+  }
+  return output_item(&l->other, "<other>", &e);
+}
+
+
+static int item(struct dir *d, const char *name, struct dir_ext *ext) {
+  if(!d) {
+    if(depth-- > kept)
+      return 0;
+    kept--;
+    return other(&levels[depth]) || output_item(NULL, NULL, NULL);
+  }
+
+  if(depth > kept || (dir_max_depth >= 0 && base+depth > dir_max_depth)
+      || (depth && !(d->flags & FF_DIR) && d->size < dir_min_size && d->asize < dir_min_size)) {
+    if(d->flags & FF_HLNKC)
+      return prune_hlnk(d, ext);
+    prune(d, ext);
+    if(d->flags & FF_DIR)
+      push(d->dev);
+    return 0;
+  }
+
+  if(d->flags & FF_DIR) {
+    push(d->dev);
+    levels[kept++].id = ++lastid;
+  }
+  return output_item(d, name, ext);
+}
+
+
+void dir_summary_init(int _base) {
+  if(dir_max_depth < 0 && !dir_min_size)
+    return;
+  base = _base;
+  depth = kept = 0;
+  lastid = 0;
+  if(links)
+    hs_destroy(links);
+  links = hs_init();
+  output_item = dir_output.item;
+  dir_output.item = item;
+}
@@ -27,6 +27,16 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
+#ifdef HAVE_LOCALE_H
+#include <locale.h>
+#endif
+
+#include <khashl.h>
+
+#if HAVE_SYS_MMAN_H && HAVE_MADVISE
+#include <sys/mman.h>
+#endif
 
 
 /* public variables */
@@ -38,35 +48,254 @@ int64_t dirlist_maxs       = 0,
 int    dirlist_sort_desc   = 1,
        dirlist_sort_col    = DL_COL_SIZE,
        dirlist_sort_df     = 0,
-       dirlist_hidden      = 0;
+       dirlist_hidden      = 0,
+       dirlist_tree        = 0;
+
+char   dirlist_filter[DL_FILTER_MAX+1];
 
 /* private state vars */
-static struct dir *parent_alloc, *head, *head_real, *selected, *top = NULL;
+static struct dir *parent_alloc, *selected, *top = NULL;
+
+/* The items of the opened directory. The fields that sorting and the passes
+ * over the whole listing look at are copied into separate arrays, so those
+ * stream through memory instead of hopping between nodes. The arrays are in
+ * the order the items were read from the tree, lorder[] holds the sorted
+ * order. Items only have a link to the next item, so this is also used to
+ * find the previous one.
+ * The first listlen items are those of the opened directory. In the tree view
+ * the contents of the expanded directories are loaded after those, lsub[] and
+ * lnsub[] have the index and number of the items of a directory, or -1 when
+ * they're not loaded, and the items are sorted within that range. lpar[] has
+ * the index of the directory an item is in, -1 for the opened directory. */
+static struct dir **lnode;
+static int64_t *lsize, *lasize, *lmtime;
+static int *litems, *lorder, *lpar, *ldepth, *lsub, *lnsub;
+static unsigned char *lflags;
+static int listlen, lload, listsize;
+
+/* Names are sorted by a key in which the numbers in the name sort by their
+ * value, collated for the current locale. The keys are computed the first
+ * time they're needed and kept in lnbuf until another directory is opened,
+ * lnkey[] has their offset, 0 when there's no key yet. Each key follows the
+ * reference of its name, which is never changed. When the same directory is
+ * opened again, after it changed or while it's being scanned, the items are
+ * given back the keys of their names through oldkeys. */
+KHASHL_MAP_INIT(KH_LOCAL, nk_t, nk, uint32_t, size_t, kh_hash_uint32, kh_eq_generic)
+static char *lnbuf;
+static size_t *lnkey, lnlen, lnsize;
+static nk_t *oldkeys;
+static int collate = -1;
+
+/* The filter. fhist is the longest filter that the current one is the start
+ * of, that's the one that was typed before removing characters from it.
+ * lflen[] has for each item of the opened directory the length of the
+ * longest start of fhist that is in its name, the item matches when that's
+ * at least the length of the filter. A filter that starts with the previous
+ * one then only has to look at the names of the items that matched that one,
+ * and removing characters doesn't have to look at the names at all. lmatch[]
+ * has the positions in lorder[] of the matching items, in sorted order. Up to
+ * fupper, the filter has no upper case letters and matches regardless of
+ * case. */
+static char fhist[DL_FILTER_MAX+1];
+static unsigned char *lflen;
+static int *lmatch, nmatch, flen, fhlen, fupper;
+static int64_t fsize, fasize;
+static int fitems;
+
+/* The rows of the browser: the parent reference followed by the items that
+ * are not hidden, in sorted order. In the tree view the rows of the contents
+ * of an expanded directory follow its row, those are inserted and removed
+ * when it's expanded or collapsed. lvis[] holds their index in lnode[], so any
+ * row can be looked up directly. The rows of the selected item, the top item
+ * and the most recently looked up item are remembered, lookups are almost
+ * always for one of those or a row next to them. */
+static int *lvis;
+static int nvis, selrow, toprow, lastrow;
+
+#define VIS0 (dirlist_parent ? 1 : 0) /* the row of lvis[0] */
+#define ROWS (nvis + VIS0)
+
+#define LF_DIR  1
+#define LF_HIDE 2 /* hidden when dirlist_hidden is set */
+#define LF_WIN  4 /* temporary, used while selecting the sorted window */
+#define LF_LOW  8 /* temporary, the item sorts before the selected item */
+#define LF_SEL 16 /* has FF_BSEL, so the rows can be built without looking at the items */
+
+/* Large directories are at first only sorted as far as they are shown: the
+ * LAZY_WIN items around the selected item are selected and sorted, those are
+ * at lorder[lfrom] to lorder[lto-1] and in their final position, the items
+ * before and after that are in no particular order. Their rows are
+ * [wfrom,wto), the parent reference is always at the top. The rest is sorted
+ * when the browser needs it or is idle, the order is only stored in the tree
+ * after that. lsel is the index of the selected item, or -1. */
+#define LAZY_MIN 65536
+#define LAZY_WIN 2048
+static int lfrom, lto, wfrom, wto, lsel;
+
+/* The rest of such a list is sorted in steps, so that keys are handled in
+ * between: first [0,lfrom) and then [lto,listlen) are sorted as runs of
+ * SORT_RUN items, which are then merged pairwise into lmoved[], SORT_MERGE
+ * items per step, and copied back when a pair is done. lorder[] thus always
+ * holds every item, and the window is widened over a range when it's sorted.
+ * [sfrom,sto) is the range that is being sorted, swidth the length of the
+ * runs that are merged or 0 while the runs are sorted, spos the start of the
+ * current run or pair and sa/sb the number of items merged from each run of
+ * the pair. */
+#define SORT_RUN   65536
+#define SORT_MERGE 262144
+static int sfrom, sto, swidth, spos, sa, sb;
+
+/* The totals of the opened directory at the last update, while a scan in the
+ * background is still reading it. When those change, the items that have been
+ * added to the directories that are listed are loaded, and the totals of the
+ * items that are being read are updated, large directories only every few
+ * updates. New items are added to the start of a directory, listhead and
+ * lhead[] have the first item of the opened directory and of the expanded
+ * ones as of when they were loaded or linked. lopen[] has the indexes of the
+ * directories that were being read at the last update. */
+static int64_t livesize, liveasize;
+static int liveitems, liveskip;
+static struct dir *listhead, **lhead;
+static int *lopen, nopen, opensize;
+
+/* The sorted order is kept in the tree, so a directory only has to be sorted
+ * again when the sort configuration or its contents changed. Directories with
+ * FF_SORTED have an entry in this side table with the configuration that
+ * their items have been sorted by, and SORT_DIRTY when some of the items
+ * have been changed, added or removed since. Entries are removed with
+ * dirlist_free() when the directory is freed. */
+KHASHL_MAP_INIT(KH_LOCAL, ds_t, ds, uint32_t, unsigned char, kh_hash_uint32, kh_eq_generic)
+static ds_t *sorted = NULL;
+static int *lmoved;
+
+#define SORT_DIRTY  0x80
+#define SORT_CONFIG (dirlist_sort_col | dirlist_sort_desc<<3 | dirlist_sort_df<<4)
+
+#define LNODE(p)   lnode[lorder[p]]
+#define LHIDDEN(p) (dirlist_hidden && lflags[lorder[p]] & LF_HIDE)
+
+
+
+/* Items that are hidden with dirlist_hidden: excluded, or named like a dotfile
+ * or a backup. Only the first and last byte of the name are looked at, the
+ * names of the items that aren't drawn are never decoded. */
+static int dirlist_hideable(struct dir *d) {
+  return d->flags & FF_EXL || name_char(d->name, 0) == '.' || name_char(d->name, -1) == '~';
+}
+
 
+/* Writes the key of the given name to lnbuf, after its reference, and returns
+ * its offset. Each run of digits is replaced by its length without leading
+ * zeros, followed by the digits. The length is encoded as a '9' for every 9
+ * digits and a last digit for the rest, so that a longer number sorts after a
+ * shorter one. Without collation that's the key, otherwise the result is
+ * passed to strxfrm(). */
+static size_t dirlist_namekey(uint32_t ref, const char *name) {
+  static char *tmp;
+  static size_t tmpsize;
+  size_t n = strlen(name)*2+2, off = lnlen+sizeof(ref);
+  const char *e;
+  char *t;
+  int l;
+
+  if(collate < 0) {
+    collate = 0;
+#ifdef HAVE_LOCALE_H
+    e = setlocale(LC_COLLATE, NULL);
+    collate = e && strcmp(e, "C") && strcmp(e, "POSIX") && strncmp(e, "C.", 2);
+#endif
+  }
 
+  if(collate && n > tmpsize) {
+    tmpsize = n*2;
+    tmp = xrealloc(tmp, tmpsize);
+  }
+  if(off+n > lnsize) {
+    lnsize = lnsize*2 > off+n ? lnsize*2 : off+n;
+    lnbuf = xrealloc(lnbuf, lnsize);
+  }
+  memcpy(lnbuf+lnlen, &ref, sizeof(ref));
+  t = collate ? tmp : lnbuf+off;
 
-#define ISHIDDEN(d) (dirlist_hidden && (d) != dirlist_parent && (\
-    (d)->flags & FF_EXL || (d)->name[0] == '.' || (d)->name[strlen((d)->name)-1] == '~'\
-  ))
+  while(*name) {
+    if(*name < '0' || *name > '9') {
+      *t++ = *name++;
+      continue;
+    }
+    while(*name == '0' && name[1] >= '0' && name[1] <= '9')
+      name++;
+    for(e=name; *e >= '0' && *e <= '9'; e++)
+      ;
+    for(l=e-name-1; l>=9; l-=9)
+      *t++ = '9';
+    *t++ = '0'+l;
+    while(name < e)
+      *t++ = *name++;
+  }
+  *t++ = 0;
 
+  if(!collate) {
+    lnlen = t-lnbuf;
+    return off;
+  }
 
-static inline int cmp_mtime(struct dir *x, struct dir*y) {
-  int64_t x_mtime = 0, y_mtime = 0;
-  if (x->flags & FF_EXT)
-    x_mtime = dir_ext_ptr(x)->mtime;
-  if (y->flags & FF_EXT)
-    y_mtime = dir_ext_ptr(y)->mtime;
-  return (x_mtime > y_mtime ? 1 : (x_mtime == y_mtime ? 0 : -1));
+  n = t-tmp-1;
+  while(off+n >= lnsize || (n = strxfrm(lnbuf+off, tmp, lnsize-off)) >= lnsize-off) {
+    lnsize = lnsize*2 > off+n+1 ? lnsize*2 : off+n+1;
+    lnbuf = xrealloc(lnbuf, lnsize);
+  }
+  lnlen = off+n+1;
+  return off;
 }
 
-static int dirlist_cmp(struct dir *x, struct dir *y) {
+
+/* Puts the keys that the loaded items have in oldkeys, before the list is
+ * loaded again. The items may have been freed already, so the references of
+ * their names are taken from lnbuf. */
+static void dirlist_oldkeys(void) {
+  uint32_t ref;
+  khint_t k;
+  int x, absent;
+
+  for(x=0; x<lload; x++)
+    if(lnkey[x]) {
+      if(!oldkeys)
+        oldkeys = nk_init();
+      memcpy(&ref, lnbuf+lnkey[x]-sizeof(ref), sizeof(ref));
+      k = nk_put(oldkeys, ref, &absent);
+      kh_val(oldkeys, k) = lnkey[x];
+    }
+}
+
+
+static const char *dirlist_nkey(int x) {
+  if(!lnkey[x])
+    lnkey[x] = dirlist_namekey(lnode[x]->name, dir_name(lnode[x]));
+  return lnbuf+lnkey[x];
+}
+
+
+/* Compares the names by their key, then byte by byte */
+static int dirlist_namecmp(int x, int y) {
+  int r;
+
+  /* the second key may move the first one */
+  dirlist_nkey(x);
+  dirlist_nkey(y);
+  r = strcmp(lnbuf+lnkey[x], lnbuf+lnkey[y]);
+  return r ? r : strcmp(dir_name(lnode[x]), dir_name(lnode[y]));
+}
+
+
+/* x and y are indices into the l* arrays */
+static int dirlist_cmp(int x, int y) {
   int r;
 
   /* dirs are always before files when that option is set */
   if(dirlist_sort_df) {
-    if(y->flags & FF_DIR && !(x->flags & FF_DIR))
+    if(lflags[y] & LF_DIR && !(lflags[x] & LF_DIR))
       return 1;
-    else if(!(y->flags & FF_DIR) && x->flags & FF_DIR)
+    else if(!(lflags[y] & LF_DIR) && lflags[x] & LF_DIR)
       return -1;
   }
 
@@ -79,17 +308,18 @@ static int dirlist_cmp(struct dir *x, struct dir *y) {
    *
    * Note that the method used below is supposed to be fast, not readable :-)
    */
-#define CMP_NAME  strcmp(x->name, y->name)
-#define CMP_SIZE  (x->size  > y->size  ? 1 : (x->size  == y->size  ? 0 : -1))
-#define CMP_ASIZE (x->asize > y->asize ? 1 : (x->asize == y->asize ? 0 : -1))
-#define CMP_ITEMS (x->items > y->items ? 1 : (x->items == y->items ? 0 : -1))
+#define CMP_NAME  dirlist_namecmp(x, y)
+#define CMP_SIZE  (lsize[x]  > lsize[y]  ? 1 : (lsize[x]  == lsize[y]  ? 0 : -1))
+#define CMP_ASIZE (lasize[x] > lasize[y] ? 1 : (lasize[x] == lasize[y] ? 0 : -1))
+#define CMP_ITEMS (litems[x] > litems[y] ? 1 : (litems[x] == litems[y] ? 0 : -1))
+#define CMP_MTIME (lmtime[x] > lmtime[y] ? 1 : (lmtime[x] == lmtime[y] ? 0 : -1))
 
   /* try 1 */
   r = dirlist_sort_col == DL_COL_NAME ? CMP_NAME :
       dirlist_sort_col == DL_COL_SIZE ? CMP_SIZE :
       dirlist_sort_col == DL_COL_ASIZE ? CMP_ASIZE :
       dirlist_sort_col == DL_COL_ITEMS ? CMP_ITEMS :
-      cmp_mtime(x, y);
+      CMP_MTIME;
   /* try 2 */
   if(!r)
     r = dirlist_sort_col == DL_COL_SIZE ? CMP_ASIZE : CMP_SIZE;
@@ -109,99 +339,1052 @@ static int dirlist_cmp(struct dir *x, struct dir *y) {
 }
 
 
-static struct dir *dirlist_sort(struct dir *list) {
-  struct dir *p, *q, *e, *tail;
-  int insize, nmerges, psize, qsize, i;
-
-  insize = 1;
-  while(1) {
-    p = list;
-    list = NULL;
-    tail = NULL;
-    nmerges = 0;
-    while(p) {
-      nmerges++;
-      q = p;
-      psize = 0;
-      for(i=0; i<insize; i++) {
-        psize++;
-        q = q->next;
-        if(!q) break;
-      }
-      qsize = insize;
-      while(psize > 0 || (qsize > 0 && q)) {
-        if(psize == 0) {
-          e = q; q = q->next; qsize--;
-        } else if(qsize == 0 || !q) {
-          e = p; p = p->next; psize--;
-        } else if(dirlist_cmp(p,q) <= 0) {
-          e = p; p = p->next; psize--;
-        } else {
-          e = q; q = q->next; qsize--;
-        }
-        if(tail) tail->next = e;
-        else     list = e;
-        e->prev = tail;
-        tail = e;
+static int dirlist_qcmp(const void *x, const void *y) {
+  return dirlist_cmp(*(const int *)x, *(const int *)y);
+}
+
+
+/* updates the links between the items of *d, at lorder[from] to
+ * lorder[to-1], to match the sorted list and records the sort configuration
+ * of the directory */
+static void dirlist_link(struct dir *d, int from, int to) {
+  khint_t k;
+  int i, absent;
+
+  for(i=from; i<to; i++)
+    LNODE(i)->next = i+1 < to ? dir_ref(LNODE(i+1)) : 0;
+  d->sub = dir_ref(LNODE(from));
+  if(lpar[lorder[from]] < 0)
+    listhead = LNODE(from);
+  else
+    lhead[lpar[lorder[from]]] = LNODE(from);
+
+  if(!sorted)
+    sorted = ds_init();
+  k = ds_put(sorted, dir_ref(d), &absent);
+  kh_val(sorted, k) = SORT_CONFIG;
+  d->flags |= FF_SORTED;
+}
+
+
+/* The columns that dirlist_cmp() looks at for each sort column, in order.
+ * Names are compared by their key first and then byte by byte, which is
+ * COL_BYTES here. */
+#define COL_BYTES 5
+
+static const int dirlist_levels[5][5] = {
+  { DL_COL_NAME,  COL_BYTES,    DL_COL_SIZE,  DL_COL_ASIZE, DL_COL_ITEMS }, /* NAME */
+  { DL_COL_SIZE,  DL_COL_ASIZE, DL_COL_NAME,  COL_BYTES,    DL_COL_ITEMS }, /* SIZE */
+  { DL_COL_ASIZE, DL_COL_SIZE,  DL_COL_NAME,  COL_BYTES,    DL_COL_ITEMS }, /* ASIZE */
+  { DL_COL_ITEMS, DL_COL_SIZE,  DL_COL_ASIZE, DL_COL_NAME,  COL_BYTES    }, /* ITEMS */
+  { DL_COL_MTIME, DL_COL_SIZE,  DL_COL_NAME,  COL_BYTES,    DL_COL_ITEMS }, /* MTIME */
+};
+
+
+/* The key of the item at x for the given column, inverted when sorting in
+ * descending order, with the top bit set for files when directories are
+ * sorted first. Names are represented by 7 bytes of their key or the name
+ * itself, starting at the given offset, and the 4 bytes after those are
+ * written to *next. */
+static uint64_t dirlist_key(int x, int col, int df, int off, uint32_t *next) {
+  const unsigned char *n;
+  uint64_t k = 0;
+  uint32_t nk = 0;
+  int64_t v;
+  int i;
+
+  if(col == DL_COL_NAME || col == COL_BYTES) {
+    n = (const unsigned char *)(col == COL_BYTES ? dir_name(lnode[x]) : dirlist_nkey(x)) + off;
+    for(i=0; i<7; i++)
+      k = k<<8 | (*n ? *n++ : 0);
+    for(i=0; i<4; i++)
+      nk = nk<<8 | (*n ? *n++ : 0);
+    if(dirlist_sort_desc) {
+      k = ~k & (((uint64_t)1<<56)-1);
+      nk = ~nk;
+    }
+    *next = nk;
+  } else {
+    v = col == DL_COL_SIZE ? lsize[x] :
+        col == DL_COL_ASIZE ? lasize[x] :
+        col == DL_COL_ITEMS ? litems[x] :
+        lmtime[x];
+    k = v < 0 ? 0 : v;
+    if(dirlist_sort_desc)
+      k = INT64_MAX - k;
+  }
+  if(df && !(lflags[x] & LF_DIR))
+    k |= (uint64_t)1<<63;
+  return k;
+}
+
+
+struct lkey {
+  uint64_t key;
+  int x;
+  uint32_t next;  /* key of the next column, minus the lowest one */
+};
+
+
+/* insertion sort for the short runs that are left after radix sorting */
+static void dirlist_isort(struct lkey *a, int n) {
+  struct lkey t;
+  int i, j;
+
+  for(i=1; i<n; i++) {
+    t = a[i];
+    for(j=i; j>0 && dirlist_cmp(a[j-1].x, t.x) > 0; j--)
+      a[j] = a[j-1];
+    a[j] = t;
+  }
+}
+
+
+/* insertion sort on the key of the next column, which doesn't have to look up
+ * the items in the l* arrays. Those with the same key are sorted by
+ * dirlist_isort(). */
+static void dirlist_isort_next(struct lkey *a, int n) {
+  struct lkey t;
+  int i, j;
+
+  for(i=1; i<n; i++) {
+    t = a[i];
+    for(j=i; j>0 && a[j-1].next > t.next; j--)
+      a[j] = a[j-1];
+    a[j] = t;
+  }
+  for(i=0; i<n; i=j) {
+    for(j=i+1; j<n && a[j].next == a[i].next; j++)
+      ;
+    if(j-i > 1)
+      dirlist_isort(a+i, j-i);
+  }
+}
+
+
+/* Tables to replace the keys by only their bits that are set in mask,
+ * followed by the bits of their next keys that are set in nmask. That keeps
+ * them in the same order if the other bits are the same in all of them. The
+ * first 4 tables are for the bytes of the next keys. */
+static uint64_t ctab[12][256];
+
+static void dirlist_compact(uint64_t mask, uint32_t nmask) {
+  uint64_t k;
+  int i, p, v, b, m, s = 0;
+
+  for(p=0; p<12; p++) {
+    m = p < 4 ? nmask >> 8*p & 0xff : mask >> 8*(p-4) & 0xff;
+    for(v=0; v<256; v++) {
+      for(k=0, b=0, i=s; b<8; b++)
+        if(m >> b & 1)
+          k |= (uint64_t)(v >> b & 1) << i++;
+      ctab[p][v] = k;
+    }
+    s = i;
+  }
+}
+
+
+static uint64_t dirlist_compacted(const struct lkey *e) {
+  return ctab[0][e->next & 0xff] | ctab[1][e->next >> 8 & 0xff]
+    | ctab[2][e->next >> 16 & 0xff] | ctab[3][e->next >> 24]
+    | ctab[4][e->key & 0xff] | ctab[5][e->key >> 8 & 0xff]
+    | ctab[6][e->key >> 16 & 0xff] | ctab[7][e->key >> 24 & 0xff]
+    | ctab[8][e->key >> 32 & 0xff] | ctab[9][e->key >> 40 & 0xff]
+    | ctab[10][e->key >> 48 & 0xff] | ctab[11][e->key >> 56];
+}
+
+
+/* LSD radix sort on the keys. Only the bits that differ between the lowest
+ * and the highest key are sorted on, with the bit that puts files after
+ * directories moved right above those, in as few passes of up to RADIX_BITS
+ * bits as that allows. Keys often also have bits that are the same in all of
+ * them in between, like the high bits of the digits in names, and large lists
+ * are sorted on only the bits that differ when that takes fewer passes. With
+ * next set, the highest bits of the next keys that still fit in those passes
+ * are added below them, which leaves fewer and shorter runs of the same key.
+ * The keys are then changed, but not their order. Returns whether the items
+ * have also been sorted by their next keys. *b is used as temporary
+ * buffer. */
+#define RADIX_BITS 12
+#define RADIX_TOP ((uint64_t)1<<63)
+
+static int dirlist_radix(struct lkey *a, struct lkey *b, int n, int next) {
+  static unsigned int cnt[8][1<<RADIX_BITS];
+  struct lkey *t, *r = a;
+  unsigned int c, pos, mask;
+  uint64_t lo = UINT64_MAX, hi = 0, diff = 0, tdiff, k;
+  uint32_t ndiff = 0, nmask;
+  int i, j, bits, np, width, low, tbit = 0, cbits = 0, nbits, compact = 0;
+
+#define RADIX_DIGIT(key, j) (unsigned int)((((((key) & ~RADIX_TOP) - lo) >> low) | ((key) >> 63 & tdiff) << tbit) >> (j)*width & mask)
+
+  for(i=0; i<n; i++) {
+    k = a[i].key & ~RADIX_TOP;
+    lo = k < lo ? k : lo;
+    hi = k > hi ? k : hi;
+    diff |= a[i].key ^ a[0].key;
+    ndiff |= a[i].next ^ a[0].next;
+  }
+  /* the lowest bits may be the same in all keys, e.g. the ends of names */
+  tdiff = diff >> 63;
+  diff &= ~RADIX_TOP;
+  for(low=0; low<63 && diff && !(diff >> low & 1); low++)
+    ;
+  for(bits=0; bits<63 && (hi-lo) >> low >> bits; bits++)
+    ;
+  if(tdiff)
+    tbit = bits++;
+  /* smaller digits for short lists, the counts are cleared for each digit */
+  width = n < 1<<16 ? 8 : RADIX_BITS;
+  np = (bits+width-1)/width;
+  for(k=diff | tdiff<<63; n >= 1<<16 && k; k&=k-1)
+    cbits++;
+  if(n >= 1<<16 && (cbits+width-1)/width < np) {
+    np = (cbits+width-1)/width;
+    compact = 1;
+  }
+  /* the passes are filled up with the highest bits of the next keys */
+  for(nmask=n >= 1<<16 && next ? ndiff : 0; nmask; nmask&=nmask-1) {
+    for(nbits=0, c=nmask; c; c&=c-1)
+      nbits++;
+    if(cbits+nbits <= np*width && cbits+nbits < 64)
+      break;
+  }
+  if(nmask || compact) {
+    compact = 1;
+    dirlist_compact(diff | tdiff<<63, nmask);
+    lo = low = tdiff = 0;
+    bits = cbits + (nmask ? nbits : 0);
+    np = (bits+width-1)/width;
+  }
+  if(!bits)
+    return !ndiff;
+  width = (bits+np-1)/np;
+  mask = (1u<<width)-1;
+
+  for(j=0; j<np; j++)
+    memset(cnt[j], 0, (mask+1)*sizeof(**cnt));
+  /* the compacted keys are written to *b when that makes the last pass end
+   * in *a */
+  t = compact && np & 1 ? b : a;
+  for(i=0; i<n; i++) {
+    if(compact) {
+      k = dirlist_compacted(a+i);
+      t[i] = a[i];
+      t[i].key = k;
+    }
+    for(k=t[i].key, j=0; j<np; j++)
+      cnt[j][RADIX_DIGIT(k, j)]++;
+  }
+  if(t != a) {
+    b = a;
+    a = t;
+  }
+
+  for(j=0; j<np; j++) {
+    for(pos=i=0; i<=(int)mask; i++) {
+      c = cnt[j][i];
+      cnt[j][i] = pos;
+      pos += c;
+    }
+    for(i=0; i<n; i++)
+      b[cnt[j][RADIX_DIGIT(a[i].key, j)]++] = a[i];
+    t = a;
+    a = b;
+    b = t;
+  }
+  if(a != r)
+    memcpy(r, a, n*sizeof(*a));
+  return nmask == ndiff;
+#undef RADIX_DIGIT
+}
+
+
+static void dirlist_sort_level(struct lkey *, struct lkey *, int, int, int);
+
+/* Sorts the items in *a, of which the names are the same in the 7 bytes from
+ * the given offset, by the 4 bytes after those that have been put in their
+ * next keys, and then by the rest of the names or the next columns. Names
+ * that end within those 11 bytes are the same. */
+static void dirlist_sort_name(struct lkey *a, struct lkey *b, int n, int level, int off) {
+  int i, j;
+
+  if(n < 32) {
+    dirlist_isort_next(a, n);
+    return;
+  }
+  for(i=0; i<n; i++)
+    a[i].key = a[i].next;
+  dirlist_radix(a, b, n, 0);
+  for(i=0; i<n; i=j) {
+    for(j=i+1; j<n && a[j].key == a[i].key; j++)
+      ;
+    if(j-i < 2)
+      continue;
+    if((a[i].next & 0xff) != (dirlist_sort_desc ? 0xff : 0))
+      dirlist_sort_level(a+i, b+i, j-i, level, off+11);
+    else
+      dirlist_sort_level(a+i, b+i, j-i, level+1, 0);
+  }
+}
+
+
+/* Sorts the items in *a, which are the same in the columns before the given
+ * level, by the remaining columns. Each level is radix sorted and the runs of
+ * items that are still the same are sorted by the next level, or by the next
+ * bytes of the name. */
+static void dirlist_sort_level(struct lkey *a, struct lkey *b, int n, int level, int off) {
+  uint64_t lo = UINT64_MAX, hi = 0, k;
+  int i, j, col, ncol, next, name, sorted;
+
+  if(level > 4)
+    return;
+  if(n < 32) {
+    dirlist_isort(a, n);
+    return;
+  }
+
+  /* Numbers are often the same for many items, which then leaves lots of
+   * short runs. The key of the next column is computed along with this one
+   * while the items are read in order, so that those runs can be sorted
+   * without looking up each item again, if the keys fit in 32 bits. Their
+   * range is found first, to not need another pass to store them. */
+  col = dirlist_levels[dirlist_sort_col][level];
+  ncol = level < 4 ? dirlist_levels[dirlist_sort_col][level+1] : COL_BYTES;
+  name = col == DL_COL_NAME || col == COL_BYTES;
+  next = !name && ncol != DL_COL_NAME && ncol != COL_BYTES;
+  for(i=0; next && i<n; i++) {
+    k = dirlist_key(a[i].x, ncol, 0, 0, NULL);
+    lo = k < lo ? k : lo;
+    hi = k > hi ? k : hi;
+  }
+  next = next && hi-lo <= UINT32_MAX;
+  for(i=0; i<n; i++) {
+    a[i].key = dirlist_key(a[i].x, col, !level && dirlist_sort_df, off, &a[i].next);
+    if(next)
+      a[i].next = dirlist_key(a[i].x, ncol, 0, 0, NULL) - lo;
+  }
+  sorted = dirlist_radix(a, b, n, name);
+
+  for(i=0; i<n; i=j) {
+    for(j=i+1; j<n && a[j].key == a[i].key; j++)
+      ;
+    if(j-i < 2)
+      continue;
+    if(name && !sorted)
+      dirlist_sort_name(a+i, b+i, j-i, level, off);
+    else if(name && (a[i].next & 0xff) != (dirlist_sort_desc ? 0xff : 0))
+      dirlist_sort_level(a+i, b+i, j-i, level, off+11);
+    else if(next && j-i < 32)
+      dirlist_isort_next(a+i, j-i);
+    else
+      dirlist_sort_level(a+i, b+i, j-i, level+1, 0);
+  }
+}
+
+
+/* Large lists are sorted in memory that is likely to get huge pages, the
+ * radix sort goes through all of it a few times. It's kept until another
+ * directory is opened, as the list is often sorted again and the first write
+ * to new memory takes about as long as another pass. */
+static struct lkey *sortbuf;
+static size_t sortsize;
+
+/* sorts lorder[from] to lorder[to-1] */
+static void dirlist_sort_range(int from, int to) {
+  struct lkey *a, *b;
+  size_t size;
+  int i, x, n = to-from;
+
+  if(n < 2)
+    return;
+
+  size = 2*(size_t)n*sizeof(*a);
+  if(size < ARENA_CHUNK)
+    a = xmalloc(size);
+  else {
+    if(size > sortsize) {
+      free(sortbuf);
+      sortsize = 2*(size_t)lload*sizeof(*a);
+      sortbuf = xmemalign(ARENA_CHUNK, sortsize);
+#if HAVE_SYS_MMAN_H && HAVE_MADVISE && defined(MADV_HUGEPAGE)
+      madvise(sortbuf, sortsize, MADV_HUGEPAGE);
+#endif
+    }
+    a = sortbuf;
+  }
+  b = a+n;
+
+  /* The keys are read much faster in the order of the items than in the
+   * order of lorder[], which is random after sorting on another column. The
+   * items of a large range are flagged and collected in order, those of the
+   * opened directory are in [0,listlen) and those of an expanded one in the
+   * range itself. When the range is most of the opened directory, as when
+   * the rest of a lazily sorted list is sorted, the few items outside of it
+   * are flagged instead. */
+  if(n < LAZY_MIN)
+    for(i=0; i<n; i++)
+      a[i].x = lorder[from+i];
+  else if(from < listlen && n > listlen/2) {
+    for(i=0; i<listlen; i++)
+      if(i < from || i >= to)
+        lflags[lorder[i]] |= LF_WIN;
+    for(i=0, x=0; x<listlen; x++)
+      if(lflags[x] & LF_WIN)
+        lflags[x] &= ~LF_WIN;
+      else
+        a[i++].x = x;
+  } else {
+    for(i=from; i<to; i++)
+      lflags[lorder[i]] |= LF_WIN;
+    for(i=0, x=from < listlen ? 0 : from; i<n; x++)
+      if(lflags[x] & LF_WIN) {
+        lflags[x] &= ~LF_WIN;
+        a[i++].x = x;
       }
-      p = q;
+  }
+  dirlist_sort_level(a, b, n, 0, 0);
+  for(i=0; i<n; i++)
+    lorder[from+i] = a[i].x;
+  if(a != sortbuf)
+    free(a);
+}
+
+
+/* Adds x to a heap of n items that has the last item in sort order at the
+ * top, or the first when dir is -1. When the heap is full, which is when n is
+ * its size, x replaces the top item. */
+static void dirlist_heap(int *h, int n, int size, int x, int dir) {
+  int i, c;
+
+  if(n < size) {
+    for(i=n; i>0 && dirlist_cmp(h[(i-1)/2], x)*dir < 0; i=(i-1)/2)
+      h[i] = h[(i-1)/2];
+  } else {
+    for(i=0; (c = 2*i+1) < size; i=c) {
+      if(c+1 < size && dirlist_cmp(h[c+1], h[c])*dir > 0)
+        c++;
+      if(dirlist_cmp(h[c], x)*dir < 0)
+        break;
+      h[i] = h[c];
     }
-    tail->next = NULL;
-    if(nmerges <= 1) {
-      if(list->parent)
-        list->parent->sub = list;
-      return list;
+  }
+  h[i] = x;
+}
+
+
+/* Selects the k items around the selected item without sorting the whole
+ * list: the last k/2 items before the selected item and the first items from
+ * the selected item on are each kept in a heap. Those are sorted and put in
+ * their final position in lorder[]. A heap only takes in a few items when
+ * they come in random order, but every item when they come in the order in
+ * which each one replaces the top. Lists are often more or less sorted
+ * already, so each heap is filled in the direction that goes against the
+ * order that the items appear to be in. */
+static void dirlist_sort_window(int k) {
+  int *lo = xmalloc(k*sizeof(*lo)), *hi = lo+k/2;
+  int nlo = 0, nhi = 0, nlow = 0, asc = 0, x, i, j;
+
+  for(i=1; i<64; i++) {
+    x = (int64_t)listlen*i/64;
+    asc += dirlist_cmp(x-1, x) < 0;
+  }
+  asc = asc >= 32;
+
+  for(i=0; i<listlen; i++) {
+    x = asc ? i : listlen-1-i;
+    if(lsel >= 0 && x != lsel && dirlist_cmp(x, lsel) < 0) {
+      lflags[x] |= LF_LOW;
+      nlow++;
+    } else if(nhi < k-k/2 || dirlist_cmp(x, hi[0]) < 0) {
+      dirlist_heap(hi, nhi, k-k/2, x, 1);
+      if(nhi < k-k/2)
+        nhi++;
+    }
+  }
+  for(i=0; nlow && i<listlen; i++) {
+    x = asc ? listlen-1-i : i;
+    if(lflags[x] & LF_LOW && (nlo < k/2 || dirlist_cmp(x, lo[0]) > 0)) {
+      dirlist_heap(lo, nlo, k/2, x, -1);
+      if(nlo < k/2)
+        nlo++;
+    }
+  }
+  qsort(lo, nlo, sizeof(*lo), dirlist_qcmp);
+  qsort(hi, nhi, sizeof(*hi), dirlist_qcmp);
+
+  lfrom = nlow-nlo;
+  lto = nlow+nhi;
+  sfrom = sto = 0;
+  for(i=0; i<nlo; i++) {
+    lorder[lfrom+i] = lo[i];
+    lflags[lo[i]] |= LF_WIN;
+  }
+  for(i=0; i<nhi; i++) {
+    lorder[nlow+i] = hi[i];
+    lflags[hi[i]] |= LF_WIN;
+  }
+  for(x=i=0, j=lto; x<listlen; x++) {
+    if(!(lflags[x] & LF_WIN))
+      lorder[lflags[x] & LF_LOW ? i++ : j++] = x;
+    lflags[x] &= ~(LF_WIN|LF_LOW);
+  }
+  free(lo);
+}
+
+
+/* sorts the list */
+static void dirlist_sort(void) {
+  lfrom = 0;
+  lto = listlen;
+  if(!listlen)
+    return;
+  if(listlen < LAZY_MIN) {
+    dirlist_sort_range(0, listlen);
+    dirlist_link(dirlist_par, 0, listlen);
+  } else
+    dirlist_sort_window(winrows*4 > LAZY_WIN ? winrows*4 : LAZY_WIN);
+}
+
+
+/* Sorts a list that was sorted before some of its items changed. A single
+ * pass keeps the items that are still in order, an item that breaks the order
+ * is taken out unless it's the previous item that is out of place. The few
+ * items that were taken out are sorted and merged back in. */
+static void dirlist_resort(void) {
+  int i, j, n = 0, m = 0, x;
+
+  for(i=0; i<listlen; i++) {
+    x = lorder[i];
+    if(n && dirlist_cmp(lorder[n-1], x) > 0) {
+      if(n > 1 && dirlist_cmp(lorder[n-2], x) > 0) {
+        lmoved[m++] = x;
+        continue;
+      }
+      lmoved[m++] = lorder[--n];
     }
-    insize *= 2;
+    lorder[n++] = x;
+  }
+
+  /* too much has changed, a full sort is faster */
+  if(m > listlen/16 + 16) {
+    memcpy(lorder+n, lmoved, m*sizeof(*lorder));
+    dirlist_sort();
+    return;
+  }
+
+  qsort(lmoved, m, sizeof(*lmoved), dirlist_qcmp);
+  for(i=n-1, j=m-1, x=listlen-1; j>=0; x--)
+    lorder[x] = i >= 0 && dirlist_cmp(lorder[i], lmoved[j]) > 0 ? lorder[i--] : lmoved[j--];
+  dirlist_link(dirlist_par, 0, listlen);
+}
+
+
+void dirlist_changed(struct dir *d) {
+  khint_t k;
+
+  if(!sorted)
+    return;
+  for(; d; d=dir_parent(d))
+    if(d->flags & FF_SORTED && (k = ds_get(sorted, dir_ref(d))) != kh_end(sorted))
+      kh_val(sorted, k) |= SORT_DIRTY;
+}
+
+
+void dirlist_free(struct dir *d) {
+  khint_t k;
+
+  if(sorted && d->flags & FF_SORTED && (k = ds_get(sorted, dir_ref(d))) != kh_end(sorted))
+    ds_del(sorted, k);
+}
+
+
+void dirlist_free_arena(struct arena *a) {
+  uint32_t *refs;
+  khint_t k;
+  int i, n = 0;
+
+  if(!sorted || !kh_size(sorted))
+    return;
+  refs = xmalloc(kh_size(sorted)*sizeof(*refs));
+  for(k=0; k<kh_end(sorted); k++)
+    if(__kh_used(sorted->used, k) && arena_of(dir_ptr(kh_key(sorted, k))) == a)
+      refs[n++] = kh_key(sorted, k);
+  /* deleting moves the other entries around, so that's done afterwards */
+  for(i=0; i<n; i++)
+    ds_del(sorted, ds_get(sorted, refs[i]));
+  free(refs);
+}
+
+
+static void list_grow(void) {
+  listsize = listsize ? listsize*2 : 128;
+  lnode  = xrealloc(lnode,  listsize*sizeof(*lnode));
+  lsize  = xrealloc(lsize,  listsize*sizeof(*lsize));
+  lasize = xrealloc(lasize, listsize*sizeof(*lasize));
+  lmtime = xrealloc(lmtime, listsize*sizeof(*lmtime));
+  litems = xrealloc(litems, listsize*sizeof(*litems));
+  lorder = xrealloc(lorder, listsize*sizeof(*lorder));
+  lpar   = xrealloc(lpar,   listsize*sizeof(*lpar));
+  ldepth = xrealloc(ldepth, listsize*sizeof(*ldepth));
+  lsub   = xrealloc(lsub,   listsize*sizeof(*lsub));
+  lnsub  = xrealloc(lnsub,  listsize*sizeof(*lnsub));
+  lflags = xrealloc(lflags, listsize*sizeof(*lflags));
+  lflen  = xrealloc(lflen,  listsize*sizeof(*lflen));
+  lmatch = xrealloc(lmatch, listsize*sizeof(*lmatch));
+  lmoved = xrealloc(lmoved, listsize*sizeof(*lmoved));
+  lvis   = xrealloc(lvis,   listsize*sizeof(*lvis));
+  lnkey  = xrealloc(lnkey,  listsize*sizeof(*lnkey));
+  lhead  = xrealloc(lhead,  listsize*sizeof(*lhead));
+}
+
+
+/* Returns the sort state that *d has in the side table, or -1 */
+static int dirlist_state(struct dir *d) {
+  khint_t k;
+
+  if(sorted && d->flags & FF_SORTED && (k = ds_get(sorted, dir_ref(d))) != kh_end(sorted))
+    return kh_val(sorted, k);
+  return -1;
+}
+
+
+/* Sets the item at index x to *t, which is in the directory at index par.
+ * open is the subdirectory that is still being read, which is listed with the
+ * items read so far. */
+static void dirlist_item(int x, struct dir *t, int par, struct dir *open) {
+  khint_t k;
+
+  lnode[x] = t;
+  if(t == open) {
+    dir_mem_live(t, lsize+x, lasize+x, litems+x);
+    if(nopen == opensize)
+      lopen = xrealloc(lopen, (opensize = opensize ? opensize*2 : 16)*sizeof(*lopen));
+    lopen[nopen++] = x;
+  } else {
+    lsize[x] = t->size;
+    lasize[x] = t->asize;
+    litems[x] = t->items;
+  }
+  lmtime[x] = dir_mtime(t);
+  lflags[x] = (t->flags & FF_DIR ? LF_DIR : 0) | (dirlist_hideable(t) ? LF_HIDE : 0) | (t->flags & FF_BSEL ? LF_SEL : 0);
+  lnkey[x] = oldkeys && (k = nk_get(oldkeys, t->name)) != kh_end(oldkeys) ? kh_val(oldkeys, k) : 0;
+  lflen[x] = 0;
+  lorder[x] = x;
+  lpar[x] = par;
+  ldepth[x] = par < 0 ? 0 : ldepth[par]+1;
+  lsub[x] = -1;
+  if(par < 0 && t->flags & FF_BSEL && lsel < 0)
+    lsel = x;
+}
+
+
+/* Appends the items of *d to the list as the contents of the item at index
+ * par. Returns the number of items. */
+static int dirlist_load(struct dir *d, int par) {
+  struct dir *t, *open = dir_mem_scanning(d);
+  int n = 0;
+
+  if(par < 0)
+    listhead = dir_sub(d);
+  else
+    lhead[par] = dir_sub(d);
+  for(t=dir_sub(d); t; t=dir_next(t), n++) {
+    if(lload == listsize)
+      list_grow();
+    dirlist_item(lload++, t, par, open);
+  }
+  return n;
+}
+
+
+/* Loads the contents of the expanded directory at index x, they're sorted
+ * completely and only when the order in the tree isn't up to date */
+static void dirlist_load_sub(int x) {
+  struct dir *d = lnode[x];
+  int from = lload, n = dirlist_load(d, x);
+
+  lsub[x] = from;
+  lnsub[x] = n;
+  if(n && dirlist_state(d) != SORT_CONFIG) {
+    dirlist_sort_range(from, from+n);
+    dirlist_link(d, from, from+n);
+  }
+}
+
+
+/* Drops the contents of the expanded directories from the list, they're
+ * loaded and sorted again when they're shown */
+static void dirlist_unload(void) {
+  int i, j;
+
+  for(i=0; i<listlen; i++)
+    lsub[i] = -1;
+  lload = listlen;
+  for(i=j=0; i<nopen; i++)
+    if(lopen[i] < listlen)
+      lopen[j++] = lopen[i];
+  nopen = j;
+}
+
+
+/* Moves the items from index from on by m places, which makes room for m
+ * items at from or removes the -m items before it, and updates the indexes
+ * that refer to them */
+static void dirlist_move(int from, int m) {
+  int i, n = lload-from;
+
+  while(lload+m > listsize)
+    list_grow();
+  lload += m;
+  /* nothing refers to the items after the last one */
+  if(!n)
+    return;
+#define MOVE(a) memmove(a+from+m, a+from, n*sizeof(*a))
+  MOVE(lnode);
+  MOVE(lsize);
+  MOVE(lasize);
+  MOVE(lmtime);
+  MOVE(litems);
+  MOVE(lorder);
+  MOVE(lpar);
+  MOVE(ldepth);
+  MOVE(lsub);
+  MOVE(lnsub);
+  MOVE(lflags);
+  MOVE(lflen);
+  MOVE(lnkey);
+  MOVE(lhead);
+#undef MOVE
+
+#define SHIFT(v) if(v >= from) v += m
+  for(i=0; i<lload; i++)
+    SHIFT(lsub[i]);
+  for(i=from+m; i<lload; i++) {
+    SHIFT(lorder[i]);
+    SHIFT(lpar[i]);
   }
+  for(i=0; i<nopen; i++)
+    SHIFT(lopen[i]);
+  for(i=0; i<nvis; i++)
+    SHIFT(lvis[i]);
+#undef SHIFT
+}
+
+
+/* Removes the contents of the expanded directory at index x from the list,
+ * with those of the expanded directories in it, which are loaded after them.
+ * The items after those are moved down, when there are any. */
+static void dirlist_drop(int x) {
+  int i, j, from = lsub[x], n = lnsub[x];
+
+  if(from < 0)
+    return;
+  for(i=from; i<from+n; i++)
+    dirlist_drop(i);
+  for(i=j=0; i<nopen; i++)
+    if(lopen[i] < from || lopen[i] >= from+n)
+      lopen[j++] = lopen[i];
+  nopen = j;
+  lsub[x] = -1;
+  dirlist_move(from+n, -n);
+}
+
+
+/* Returns the index of the item in the opened directory that has the item at
+ * index x, or is x */
+static int dirlist_base(int x) {
+  while(lpar[x] >= 0)
+    x = lpar[x];
+  return x;
+}
+
+
+/* Returns whether the first n characters of the filter are in the name */
+static int dirlist_find(const char *name, int n) {
+  int i;
+
+  for(; *name; name++) {
+    if(n <= fupper)
+      for(i=0; i<n && tolower((unsigned char)name[i]) == tolower((unsigned char)dirlist_filter[i]); i++)
+        ;
+    else
+      for(i=0; i<n && name[i] == dirlist_filter[i]; i++)
+        ;
+    if(i == n)
+      return 1;
+  }
+  return 0;
+}
+
+
+/* Extends lflen[x] as far as the filter is in the name of the item at index x */
+static void dirlist_match(int x) {
+  const char *name = dir_name(lnode[x]);
+  int n = lflen[x];
+
+  while(n < flen && dirlist_find(name, n+1))
+    n++;
+  lflen[x] = n;
+}
+
+
+/* Collects the matching items, after the list has been sorted or the filter
+ * has been shortened */
+static void dirlist_matches(void) {
+  int i;
+
+  nmatch = 0;
+  for(i=0; flen && i<listlen; i++)
+    if(lflen[lorder[i]] >= flen)
+      lmatch[nmatch++] = i;
+}
+
+
+static struct dir *dirlist_row(int r) {
+  if(dirlist_parent && !r--)
+    return dirlist_parent;
+  return r >= 0 && r < nvis ? lnode[lvis[r]] : NULL;
+}
+
+
+/* Sets or clears FF_BSEL of the item on row r */
+static void dirlist_bsel(int r, int on) {
+  if(on)
+    dirlist_row(r)->flags |= FF_BSEL;
+  else
+    dirlist_row(r)->flags &= ~FF_BSEL;
+  if(r >= VIS0)
+    lflags[lvis[r-VIS0]] = on ? lflags[lvis[r-VIS0]] | LF_SEL : lflags[lvis[r-VIS0]] & ~LF_SEL;
+}
+
+
+/* Clears FF_BSEL of the item at index x, which isn't shown */
+static void dirlist_unsel(int x) {
+  if(lflags[x] & LF_SEL) {
+    lnode[x]->flags &= ~FF_BSEL;
+    lflags[x] &= ~LF_SEL;
+  }
+}
+
+
+/* Returns the row of *d, or -1 if it's not visible */
+static int dirlist_rowof(struct dir *d) {
+  int i, r, try[5];
+
+  if(!d)
+    return -1;
+  try[0] = lastrow;
+  try[1] = lastrow+1;
+  try[2] = lastrow-1;
+  try[3] = selrow;
+  try[4] = toprow;
+  for(i=0; i<5; i++)
+    if(dirlist_row(try[i]) == d)
+      return lastrow = try[i];
+  for(r=0; r<ROWS; r++)
+    if(dirlist_row(r) == d)
+      return lastrow = r;
+  return -1;
+}
+
+
+/* makes sure that row r is in its final position */
+static void dirlist_need(int r) {
+  if(r >= wto || (r < wfrom && (r > 0 || !dirlist_parent)))
+    dirlist_sort_finish();
+}
+
+
+/* Adds the row of the item at index x, followed by the rows of its contents
+ * when it's expanded in the tree view, and makes sure that only one visible
+ * item is selected */
+static void dirlist_addrow(int x) {
+  int i;
+
+  lvis[nvis++] = x;
+  if(lflags[x] & LF_SEL) {
+    if(!selected) {
+      selected = lnode[x];
+      selrow = ROWS-1;
+      lsel = dirlist_base(x);
+    } else
+      dirlist_unsel(x);
+  }
+
+  if(!dirlist_tree || !(lflags[x] & LF_DIR) || !(lnode[x]->flags & FF_EXPND))
+    return;
+  if(lsub[x] < 0)
+    dirlist_load_sub(x);
+  for(i=lsub[x]; i<lsub[x]+lnsub[x]; i++)
+    if(LHIDDEN(i))
+      dirlist_unsel(lorder[i]);
+    else
+      dirlist_addrow(lorder[i]);
 }
 
 
 /* passes through the dir listing once and:
  * - makes sure one, and only one, visible item is selected
+ * - builds the list of visible rows
  * - updates the dirlist_(maxs|maxa) values
  * - makes sure that the FF_BSEL bits are correct */
 static void dirlist_fixup(void) {
-  struct dir *t;
+  int i, j, n = flen ? nmatch : listlen;
 
   /* we're going to determine the selected items from the list itself, so reset this one */
   selected = NULL;
-
-  for(t=head; t; t=t->next) {
+  selrow = toprow = lastrow = nvis = 0;
+  wfrom = wto = dirlist_parent ? 1 : 0;
+  lsel = -1;
+  if(dirlist_parent && dirlist_parent->flags & FF_BSEL)
+    selected = dirlist_parent;
+
+  /* only the matching items are looked at when there's a filter */
+  for(j=0; j<n; j++) {
+    i = flen ? lmatch[j] : j;
     /* not visible? not selected! */
-    if(ISHIDDEN(t))
-      t->flags &= ~FF_BSEL;
+    if(LHIDDEN(i))
+      dirlist_unsel(lorder[i]);
     else {
-      /* visible and selected? make sure only one item is selected */
-      if(t->flags & FF_BSEL) {
-        if(!selected)
-          selected = t;
-        else
-          t->flags &= ~FF_BSEL;
-      }
+      dirlist_addrow(lorder[i]);
+      if(i < lfrom)
+        wfrom = ROWS;
+      if(i < lto)
+        wto = ROWS;
     }
+  }
 
-    /* update dirlist_(maxs|maxa) */
-    if(t->size > dirlist_maxs)
-      dirlist_maxs = t->size;
-    if(t->asize > dirlist_maxa)
-      dirlist_maxa = t->asize;
+  /* update dirlist_(maxs|maxa) and the totals of the matching items */
+  dirlist_maxs = dirlist_maxa = fsize = fasize = 0;
+  fitems = 0;
+  for(j=0; j<n; j++) {
+    i = flen ? lorder[lmatch[j]] : j;
+    if(lsize[i] > dirlist_maxs)
+      dirlist_maxs = lsize[i];
+    if(lasize[i] > dirlist_maxa)
+      dirlist_maxa = lasize[i];
+    fsize += lsize[i];
+    fasize += lasize[i];
+    fitems += litems[i]+1;
   }
 
   /* no selected items found after one pass? select the first visible item */
   if(!selected)
-    if((selected = dirlist_next(NULL)))
-      selected->flags |= FF_BSEL;
+    if((selected = dirlist_next(NULL))) {
+      dirlist_bsel(0, 1);
+      lsel = selected == dirlist_parent ? -1 : lvis[0];
+    }
+
+  /* the selected item has to be in the sorted part of the list */
+  dirlist_need(selrow);
+}
+
+
+int dirlist_sort_pending(void) {
+  return lfrom > 0 || lto < listlen;
+}
+
+
+/* Merges up to SORT_MERGE items of the pair of runs at spos */
+static void dirlist_merge(void) {
+  int m = spos+swidth, e = m+swidth < sto ? m+swidth : sto;
+  int o = spos+sa+sb, lim = o+SORT_MERGE;
+
+  while(o < e && o < lim)
+    if(m+sb == e || (spos+sa < m && dirlist_cmp(lorder[spos+sa], lorder[m+sb]) <= 0))
+      lmoved[o++] = lorder[spos + sa++];
+    else
+      lmoved[o++] = lorder[m + sb++];
+  if(o < e)
+    return;
+
+  memcpy(lorder+spos, lmoved+spos, (e-spos)*sizeof(*lorder));
+  spos = e;
+  sa = sb = 0;
+  /* a last run without a pair is already sorted */
+  if(spos+swidth >= sto) {
+    swidth *= 2;
+    spos = sfrom;
+  }
+}
+
+
+void dirlist_sort_step(void) {
+  int end;
+
+  if(!dirlist_sort_pending())
+    return;
+  if(sto <= sfrom) {
+    sfrom = lfrom > 0 ? 0 : lto;
+    sto = lfrom > 0 ? lfrom : listlen;
+    spos = sfrom;
+    swidth = 0;
+  }
+
+  if(!swidth) {
+    end = spos+SORT_RUN < sto ? spos+SORT_RUN : sto;
+    dirlist_sort_range(spos, end);
+    if((spos = end) == sto) {
+      swidth = SORT_RUN;
+      spos = sfrom;
+      sa = sb = 0;
+    }
+  } else
+    dirlist_merge();
+  if(!swidth || swidth < sto-sfrom)
+    return;
+
+  /* the range is sorted */
+  if(sfrom == 0 && sto == lfrom)
+    lfrom = 0;
+  else
+    lto = listlen;
+  sfrom = sto = 0;
+  if(!dirlist_sort_pending()) {
+    dirlist_link(dirlist_par, 0, listlen);
+    dirlist_matches();
+  }
+  dirlist_fixup();
+}
+
+
+/* The steps take longer than the radix sort in total, so what's left is
+ * sorted at once when the rest of the list is needed right away */
+void dirlist_sort_finish(void) {
+  if(dirlist_sort_pending()) {
+    dirlist_sort_range(0, lfrom);
+    dirlist_sort_range(lto, listlen);
+    lfrom = 0;
+    lto = listlen;
+    sfrom = sto = 0;
+    dirlist_link(dirlist_par, 0, listlen);
+    dirlist_matches();
+    dirlist_fixup();
+  }
 }
 
 
 void dirlist_open(struct dir *d) {
+  int state, i;
+
+  /* the filter only applies to the directory it was set in */
+  if(d != dirlist_par) {
+    dirlist_filter[0] = flen = 0;
+    free(sortbuf);
+    sortbuf = NULL;
+    sortsize = 0;
+    lnlen = 0;
+  } else
+    dirlist_oldkeys();
+  strcpy(fhist, dirlist_filter);
+  fhlen = flen;
   dirlist_par = d;
 
-  /* set the head of the list */
-  head_real = head = d == NULL ? NULL : d->sub;
-
   /* reset internal status */
+  listlen = lload = nvis = nopen = 0;
+  lsel = -1;
   dirlist_maxs = dirlist_maxa = 0;
 
   /* stop if this is not a directory list we can work with */
@@ -210,102 +1393,301 @@ void dirlist_open(struct dir *d) {
     return;
   }
 
-  /* sort the dir listing */
-  if(head)
-    head_real = head = dirlist_sort(head);
-
-  /* set the reference to the parent dir */
+  /* get and sort the dir listing */
+  listlen = dirlist_load(d, -1);
+  lfrom = 0;
+  lto = listlen;
+  dir_mem_live(d, &livesize, &liveasize, &liveitems);
+  liveskip = 0;
+  for(i=0; flen && i<listlen; i++)
+    dirlist_match(i);
+
+  /* only sort when the order in the tree isn't up to date */
+  state = dirlist_state(d);
+  if(state == (SORT_CONFIG|SORT_DIRTY) && listlen)
+    dirlist_resort();
+  else if(state != SORT_CONFIG)
+    dirlist_sort();
+  dirlist_matches();
+
+  /* set the reference to the parent dir, this item isn't part of the tree
+   * and has no links to any other items. */
   if(d->parent) {
     if(!parent_alloc)
-      parent_alloc = xcalloc(1, dir_memsize(".."));
+      parent_alloc = xcalloc(1, sizeof(struct dir));
     dirlist_parent = parent_alloc;
-    strcpy(dirlist_parent->name, "..");
-    dirlist_parent->next = head;
-    dirlist_parent->parent = d;
-    dirlist_parent->sub = d;
+    dirlist_parent->name = name_intern("..");
     dirlist_parent->flags = FF_DIR;
-    head = dirlist_parent;
   } else
     dirlist_parent = NULL;
 
   dirlist_fixup();
+  if(oldkeys) {
+    nk_destroy(oldkeys);
+    oldkeys = NULL;
+  }
 }
 
 
-struct dir *dirlist_next(struct dir *d) {
-  if(!head)
-    return NULL;
-  if(!d) {
-    if(!ISHIDDEN(head))
-      return head;
+/* Returns the position of the item at index x in lorder[from] to
+ * lorder[to-1]. It's looked up by its values, so before they change, and in
+ * the window of a lazily sorted list. */
+static int dirlist_pos(int from, int to, int x, int lazy) {
+  int lo = lazy ? lfrom : from, hi = lazy ? lto : to, mid;
+
+  while(lo < hi) {
+    mid = lo+(hi-lo)/2;
+    if(lorder[mid] == x)
+      return mid;
+    if(dirlist_cmp(lorder[mid], x) < 0)
+      lo = mid+1;
     else
-      d = head;
+      hi = mid;
   }
-  while((d = d->next)) {
-    if(!ISHIDDEN(d))
-      return d;
+  /* it's not in the window, or was out of order */
+  for(lo=from; lorder[lo] != x; lo++)
+    ;
+  return lo;
+}
+
+
+/* Returns whether the item at position p is still in order after its values
+ * changed */
+static int dirlist_inorder(int from, int to, int p, int lazy) {
+  if(lazy && p < lfrom)
+    return dirlist_cmp(lorder[p], lorder[lfrom]) < 0;
+  if(lazy && p >= lto)
+    return dirlist_cmp(lorder[p], lorder[lto-1]) > 0;
+  if(lazy) {
+    from = lfrom;
+    to = lto;
   }
-  return NULL;
+  return (p == from || dirlist_cmp(lorder[p-1], lorder[p]) < 0) && (p+1 == to || dirlist_cmp(lorder[p], lorder[p+1]) < 0);
 }
 
 
-static struct dir *dirlist_prev(struct dir *d) {
-  if(!head || !d)
-    return NULL;
-  while((d = d->prev)) {
-    if(!ISHIDDEN(d))
-      return d;
+/* Merges the m sorted items in ins[] into lorder[from] to lorder[end-1],
+ * which has room for them after it. This works from the back, so that each
+ * item moves only once. */
+static void dirlist_merge_in(int from, int end, const int *ins, int m) {
+  int lo, hi, mid;
+
+  while(m--) {
+    for(lo=from, hi=end; lo<hi; ) {
+      mid = lo+(hi-lo)/2;
+      if(dirlist_cmp(lorder[mid], ins[m]) > 0)
+        hi = mid;
+      else
+        lo = mid+1;
+    }
+    memmove(lorder+lo+m+1, lorder+lo, (end-lo)*sizeof(*lorder));
+    lorder[lo+m] = ins[m];
+    end = lo;
   }
-  if(dirlist_parent)
-    return dirlist_parent;
-  return NULL;
 }
 
 
-struct dir *dirlist_get(int i) {
-  struct dir *t = selected, *d;
+/* Puts the last k items of lorder[from] to lorder[to-1], which are new or
+ * have changed, in order. In a lazily sorted list only those that fall in the
+ * window are merged into it, the others are added to the unsorted items
+ * before or after it and the steps that sort those start over. */
+static void dirlist_insert(int from, int to, int k, int lazy) {
+  int i, x, nlow = 0, nmid = 0, end = to-k;
 
-  if(!head)
-    return NULL;
+  if(!lazy) {
+    memcpy(lmoved, lorder+end, k*sizeof(*lorder));
+    qsort(lmoved, k, sizeof(*lmoved), dirlist_qcmp);
+    dirlist_merge_in(from, end, lmoved, k);
+    return;
+  }
 
-  if(ISHIDDEN(selected)) {
-    selected = dirlist_next(NULL);
-    return selected;
+  /* the items before the window are collected at the start of lmoved[], those
+   * in it at the end and those after it stay at the end of lorder[] */
+  for(i=end; i<to; i++) {
+    x = lorder[i];
+    if(dirlist_cmp(x, lorder[lfrom]) < 0)
+      lmoved[nlow++] = x;
+    else if(dirlist_cmp(x, lorder[lto-1]) < 0)
+      lmoved[k-1-nmid++] = x;
+    else
+      lorder[end++] = x;
   }
+  memmove(lorder+lfrom+nlow, lorder+lfrom, (end-lfrom)*sizeof(*lorder));
+  memcpy(lorder+lfrom, lmoved, nlow*sizeof(*lorder));
+  lfrom += nlow;
+  lto += nlow;
+  memmove(lorder+lto+nmid, lorder+lto, (to-nmid-lto)*sizeof(*lorder));
+  qsort(lmoved+k-nmid, nmid, sizeof(*lmoved), dirlist_qcmp);
+  dirlist_merge_in(lfrom, lto, lmoved+k-nmid, nmid);
+  lto += nmid;
+  sfrom = sto = 0;
+}
 
-  /* i == 0? return the selected item */
-  if(!i)
-    return selected;
 
-  /* positive number? simply move forward */
-  while(i > 0) {
-    d = dirlist_next(t);
-    if(!d)
-      return t;
-    t = d;
-    if(!--i)
-      return t;
+/* Updates the items of *d, the directory at index par: the items that have
+ * been added since the last update are loaded after the others, and the
+ * items of lopen[] in it get their current totals. Those that are out of
+ * order then are taken out and put after the others, and all of those are
+ * put in order. Returns whether any item has been added or moved. */
+static int dirlist_live(struct dir *d, int par) {
+  struct dir *t, *open = dir_mem_scanning(d);
+  int64_t size, asize, mtime;
+  int from = par < 0 ? 0 : lsub[par], n = par < 0 ? listlen : lnsub[par];
+  int lazy = par < 0 && dirlist_sort_pending(), items, grew, i, m, k = 0, x, p;
+
+  for(i=0; i<nopen; i++) {
+    if(lpar[x = lopen[i]] != par)
+      continue;
+    if(lnode[x] == open)
+      dir_mem_live(lnode[x], &size, &asize, &items);
+    else {
+      size = lnode[x]->size;
+      asize = lnode[x]->asize;
+      items = lnode[x]->items;
+    }
+    mtime = dir_mtime(lnode[x]);
+    if(size == lsize[x] && asize == lasize[x] && items == litems[x] && mtime == lmtime[x])
+      continue;
+    p = dirlist_pos(from, from+n-k, x, lazy);
+    /* the totals of a directory that is being read only go up, an item that
+     * stays in place then only raises the totals and the largest size */
+    grew = size >= lsize[x] && asize >= lasize[x] && items >= litems[x];
+    if(grew && par < 0 && (!flen || lflen[x] >= flen)) {
+      fsize += size-lsize[x];
+      fasize += asize-lasize[x];
+      fitems += items-litems[x];
+      if(size > dirlist_maxs)
+        dirlist_maxs = size;
+      if(asize > dirlist_maxa)
+        dirlist_maxa = asize;
+    }
+    lsize[x] = size;
+    lasize[x] = asize;
+    litems[x] = items;
+    lmtime[x] = mtime;
+    if(!grew || !dirlist_inorder(from, from+n-k, p, lazy)) {
+      memmove(lorder+p, lorder+p+1, (from+n-p-1)*sizeof(*lorder));
+      lorder[from+n-1] = x;
+      if(lazy && p < lfrom)
+        lfrom--;
+      if(lazy && p < lto)
+        lto--;
+      k++;
+    }
   }
 
-  /* otherwise, backward */
-  while(1) {
-    d = dirlist_prev(t);
-    if(!d)
-      return t;
-    t = d;
-    if(!++i)
-      return t;
+  for(m=0, t=dir_sub(d); t && t != (par < 0 ? listhead : lhead[par]); t=dir_next(t))
+    m++;
+  if(m) {
+    dirlist_move(from+n, m);
+    for(i=0, t=dir_sub(d); i<m; i++, t=dir_next(t)) {
+      dirlist_item(from+n+i, t, par, open);
+      if(par < 0 && flen)
+        dirlist_match(from+n+i);
+    }
+    n += m;
+    k += m;
+    if(par < 0)
+      listlen = n;
+    else
+      lnsub[par] = n;
+    if(par < 0 && !lazy)
+      lto = n;
   }
+  if(par < 0)
+    listhead = dir_sub(d);
+  else
+    lhead[par] = dir_sub(d);
+  if(!k)
+    return 0;
+
+  dirlist_insert(from, from+n, k, lazy);
+  if(!lazy)
+    dirlist_link(d, from, from+n);
+  else
+    dirlist_changed(d);
+  return 1;
+}
+
+
+int dirlist_update(void) {
+  int64_t size, asize, maxs = dirlist_maxs, maxa = dirlist_maxa;
+  int items, i, j, moved;
+
+  if(!dirlist_par)
+    return 0;
+  dir_mem_live(dirlist_par, &size, &asize, &items);
+  if(size == livesize && asize == liveasize && items == liveitems)
+    return 0;
+  if(++liveskip <= listlen/LAZY_MIN)
+    return 0;
+  livesize = size;
+  liveasize = asize;
+  liveitems = items;
+  liveskip = 0;
+
+  /* the directories that were being read at the last update are the only
+   * ones that have changed, those that are expanded are updated as well */
+  moved = dirlist_live(dirlist_par, -1);
+  for(i=0; i<nopen; i++)
+    if(lsub[lopen[i]] >= 0)
+      moved |= dirlist_live(lnode[lopen[i]], lopen[i]);
+  for(i=j=0; i<nopen; i++)
+    if(dir_mem_scanning(dir_parent(lnode[lopen[i]])) == lnode[lopen[i]])
+      lopen[j++] = lopen[i];
+  nopen = j;
+
+  if(moved) {
+    dirlist_matches();
+    dirlist_fixup();
+    dirlist_top(0);
+  }
+  return moved || dirlist_maxs != maxs || dirlist_maxa != maxa;
+}
+
+
+struct dir *dirlist_next(struct dir *d) {
+  int r = 0;
+
+  if(d && (r = dirlist_rowof(d)+1) == 0)
+    return NULL;
+  if(r < ROWS)
+    dirlist_need(lastrow = r);
+  return dirlist_row(r);
+}
+
+
+struct dir *dirlist_get(int i) {
+  int r = selrow + i;
+
+  if(!ROWS)
+    return NULL;
+  if(r < 0)
+    r = 0;
+  if(r >= ROWS)
+    r = ROWS-1;
+  dirlist_need(r);
+  /* the item is usually selected next, its row is found without a search */
+  return dirlist_row(lastrow = r);
+}
+
+
+struct dir *dirlist_get_pct(int pct) {
+  return dirlist_get((int)((int64_t)ROWS*pct/100) - selrow);
 }
 
 
 void dirlist_select(struct dir *d) {
-  if(!d || !head || ISHIDDEN(d) || d->parent != head->parent)
+  int r;
+
+  if((r = dirlist_rowof(d)) < 0)
     return;
 
-  selected->flags &= ~FF_BSEL;
+  dirlist_bsel(selrow, 0);
+  dirlist_bsel(r, 1);
   selected = d;
-  selected->flags |= FF_BSEL;
+  selrow = r;
+  lsel = d == dirlist_parent ? -1 : dirlist_base(lvis[r-VIS0]);
 }
 
 
@@ -329,43 +1711,28 @@ void dirlist_select(struct dir *d) {
  * selected item is visible.
  */
 struct dir *dirlist_top(int hint) {
-  struct dir *t;
-  int i, visible = 0;
+  int r, rows = winrows-3;
 
   if(hint == -2 || hint == -3)
     top = NULL;
 
-  /* check whether the current selected item is within the visible window */
-  if(top) {
-    i = winrows-3;
-    t = dirlist_get(0);
-    while(t && i--) {
-      if(t == top) {
-        visible++;
-        break;
-      }
-      t = dirlist_prev(t);
-    }
-  }
-
-  /* otherwise, get a new top */
-  if(!visible)
-    top = hint == -1 || hint == -4 ? dirlist_get(0) :
-          hint ==  1               ? dirlist_get(-1*(winrows-4)) :
-                                     dirlist_get(-1*(winrows-3)/2);
+  /* check whether the current selected item is within the visible window,
+   * otherwise get a new top */
+  r = top ? dirlist_rowof(top) : -1;
+  if(r < 0 || r > selrow || selrow-r >= rows)
+    r = hint == -1 || hint == -4 ? selrow :
+        hint ==  1               ? selrow-(rows-1) :
+                                   selrow-rows/2;
 
   /* also make sure that if the list is longer than the window and the last
    * item is visible, that this last item is also the last on the window */
-  t = top;
-  i = winrows-3;
-  while(t && i--)
-    t = dirlist_next(t);
-  t = top;
-  do {
-    top = t;
-    t = dirlist_prev(t);
-  } while(t && i-- > 0);
+  if(r > ROWS-rows)
+    r = ROWS-rows;
+  if(r < 0)
+    r = 0;
+  dirlist_need(r);
 
+  top = dirlist_row(toprow = r);
   return top;
 }
 
@@ -380,12 +1747,10 @@ void dirlist_set_sort(int col, int desc, int df) {
     dirlist_sort_df = df;
 
   /* sort the list (excluding the parent, which is always on top) */
-  if(head_real)
-    head_real = dirlist_sort(head_real);
-  if(dirlist_parent)
-    dirlist_parent->next = head_real;
-  else
-    head = head_real;
+  dirlist_sort();
+  dirlist_matches();
+  dirlist_unload();
+  dirlist_fixup();
   dirlist_top(-3);
 }
 
@@ -396,3 +1761,142 @@ void dirlist_set_hidden(int hidden) {
   dirlist_top(-5);
 }
 
+
+void dirlist_set_filter(const char *str) {
+  int i, c;
+
+  for(flen=0; flen<DL_FILTER_MAX && str[flen]; flen++)
+    dirlist_filter[flen] = str[flen];
+  dirlist_filter[flen] = 0;
+  for(fupper=0; fupper<flen && !isupper((unsigned char)dirlist_filter[fupper]); fupper++)
+    ;
+  for(c=0; c<flen && c<fhlen && dirlist_filter[c] == fhist[c]; c++)
+    ;
+
+  /* Unless this is a filter that the longest one starts with, the items that
+   * match up to where the filter is different from that are extended from
+   * there. When the filter starts with the previous one, those are the items
+   * that matched it. The items are looked at in the order they're in memory. */
+  if(c < flen) {
+    for(i=0; i<listlen; i++) {
+      if(lflen[i] > c)
+        lflen[i] = c;
+      if(lflen[i] == c)
+        dirlist_match(i);
+    }
+    strcpy(fhist, dirlist_filter);
+    fhlen = flen;
+  }
+  dirlist_matches();
+
+  /* the first matching item is selected when the selected item doesn't
+   * match anymore */
+  if(flen && lsel >= 0 && lflen[lsel] < flen)
+    dirlist_bsel(selrow, 0);
+  dirlist_fixup();
+  if(flen && selected == dirlist_parent && nvis)
+    dirlist_select(lnode[lvis[0]]);
+  dirlist_top(-5);
+}
+
+
+void dirlist_filter_totals(int64_t *size, int64_t *asize, int *items) {
+  *size = fsize;
+  *asize = fasize;
+  *items = fitems;
+}
+
+
+void dirlist_set_tree(int tree) {
+  dirlist_tree = tree;
+  dirlist_unload();
+  /* only the items of the opened directory are shown in the normal view */
+  if(!tree && lsel >= 0 && selected != lnode[lsel]) {
+    dirlist_bsel(selrow, 0);
+    lnode[lsel]->flags |= FF_BSEL;
+    lflags[lsel] |= LF_SEL;
+  }
+  dirlist_fixup();
+  dirlist_top(-5);
+}
+
+
+void dirlist_expand(struct dir *d) {
+  int r, x, n, m, i, *tmp;
+
+  if(!dirlist_tree || d == dirlist_parent || !(d->flags & FF_DIR) || !d->sub || d->flags & FF_EXPND || (r = dirlist_rowof(d)) < 0)
+    return;
+  d->flags |= FF_EXPND;
+  x = lvis[r-VIS0];
+  n = nvis;
+
+  /* the rows are added after the last row and then moved in place, none of
+   * those is selected */
+  if(lsub[x] < 0)
+    dirlist_load_sub(x);
+  for(i=lsub[x]; i<lsub[x]+lnsub[x]; i++)
+    if(LHIDDEN(i))
+      dirlist_unsel(lorder[i]);
+    else
+      dirlist_addrow(lorder[i]);
+  if(!(m = nvis-n))
+    return;
+  tmp = xmalloc(m*sizeof(*tmp));
+  memcpy(tmp, lvis+n, m*sizeof(*tmp));
+  memmove(lvis+r-VIS0+1+m, lvis+r-VIS0+1, (n-(r-VIS0+1))*sizeof(*lvis));
+  memcpy(lvis+r-VIS0+1, tmp, m*sizeof(*tmp));
+  free(tmp);
+
+#define SHIFT(v) if(v > r) v += m
+  SHIFT(selrow);
+  SHIFT(toprow);
+  SHIFT(wfrom);
+  SHIFT(wto);
+#undef SHIFT
+  lastrow = r;
+}
+
+
+void dirlist_collapse(struct dir *d) {
+  int r, e, x, m;
+
+  if(!(d->flags & FF_EXPND))
+    return;
+  d->flags &= ~FF_EXPND;
+  if(!dirlist_tree || d == dirlist_parent || (r = dirlist_rowof(d)) < 0)
+    return;
+  x = lvis[r-VIS0];
+  for(e=r+1; e<ROWS && ldepth[lvis[e-VIS0]] > ldepth[x]; e++)
+    ;
+  /* the contents may be freed once they're not shown, they're loaded again
+   * when the directory is expanded */
+  dirlist_drop(x);
+  if(!(m = e-r-1))
+    return;
+
+  if(selrow > r && selrow < e) {
+    dirlist_bsel(selrow, 0);
+    dirlist_bsel(r, 1);
+    selected = d;
+    selrow = r;
+  }
+  if(toprow > r && toprow < e)
+    top = NULL;
+  memmove(lvis+r-VIS0+1, lvis+e-VIS0, (nvis-(e-VIS0))*sizeof(*lvis));
+  nvis -= m;
+
+#define SHIFT(v) v = v >= e ? v-m : v > r ? r+1 : v
+  SHIFT(selrow);
+  SHIFT(toprow);
+  SHIFT(wfrom);
+  SHIFT(wto);
+#undef SHIFT
+  lastrow = r;
+}
+
+
+int dirlist_depth(struct dir *d) {
+  int r = dirlist_rowof(d);
+
+  return r < VIS0 ? 0 : ldepth[lvis[r-VIS0]];
+}
@@ -39,6 +39,8 @@
 #define DL_COL_ITEMS   3
 #define DL_COL_MTIME   4
 
+#define DL_FILTER_MAX 63
+
 
 void dirlist_open(struct dir *);
 
@@ -51,6 +53,9 @@ struct dir *dirlist_next(struct dir *);
  * hidden items aren't considered */
 struct dir *dirlist_get(int i);
 
+/* Get the item at the given percentage (0-100) of the list */
+struct dir *dirlist_get_pct(int pct);
+
 /* Get/set the first visible item in the list on the screen */
 struct dir *dirlist_top(int hint);
 
@@ -60,9 +65,50 @@ void dirlist_select(struct dir *);
 /* Change sort column (arguments should have a NO_CHANGE option) */
 void dirlist_set_sort(int column, int desc, int df);
 
+/* Large directories are at first only sorted as far as they are shown. The
+ * rest of the list is sorted at once when it's needed, or a bit at a time
+ * with dirlist_sort_step() while the browser is idle. */
+int dirlist_sort_pending(void);
+void dirlist_sort_step(void);
+void dirlist_sort_finish(void);
+
+/* Loads the items that a scan in the background has added to the listed
+ * directories and the totals of the directories it's reading. Returns whether
+ * the rows changed beyond the totals of those directories. */
+int dirlist_update(void);
+
 /* Set the hidden thingy */
 void dirlist_set_hidden(int hidden);
 
+/* Only show the items of the opened directory that have the given string in
+ * their name, regardless of case if it has no upper case letters. An empty
+ * string shows all items again. The filter is cleared when another directory
+ * is opened. */
+void dirlist_set_filter(const char *str);
+
+/* The totals of the items that match the filter */
+void dirlist_filter_totals(int64_t *size, int64_t *asize, int *items);
+
+/* Switch between the normal view and the tree view, in which directories are
+ * expanded and collapsed inline. Expanding and collapsing only changes the
+ * rows of the directory's contents. */
+void dirlist_set_tree(int tree);
+void dirlist_expand(struct dir *);
+void dirlist_collapse(struct dir *);
+
+/* The depth of the row of the given item in the tree view, 0 for the items
+ * of the opened directory */
+int dirlist_depth(struct dir *);
+
+/* Called when items below the given directory have been changed, added or
+ * removed, the directory and its parents are sorted again when opened */
+void dirlist_changed(struct dir *);
+
+/* Called before the given directory is freed, or before the whole arena is
+ * destroyed, to drop what's kept about their sorted order */
+void dirlist_free(struct dir *);
+void dirlist_free_arena(struct arena *);
+
 
 /* DO NOT WRITE TO ANY OF THE BELOW VARIABLES FROM OUTSIDE OF dirlist.c! */
 
@@ -78,6 +124,12 @@ extern int dirlist_sort_desc, dirlist_sort_col, dirlist_sort_df;
 /* set with dirlist_set_hidden() */
 extern int dirlist_hidden;
 
+/* set with dirlist_set_tree() */
+extern int dirlist_tree;
+
+/* set with dirlist_set_filter() */
+extern char dirlist_filter[];
+
 /* maximum size of an item in the opened dir */
 extern int64_t dirlist_maxs, dirlist_maxa;
 
@@ -53,6 +53,11 @@
 #define FF_EXT    0x100 /* extended struct available */
 #define FF_KERNFS 0x200 /* excluded because it was a Linux pseudo filesystem */
 #define FF_FRMLNK 0x400 /* excluded because it was a firmlink */
+#define FF_INC    0x800 /* incomplete, the scan time budget ran out before (all of) this dir was read */
+#define FF_COLL  0x1000 /* collapsed, the contents have been dropped to stay within --mem-limit */
+#define FF_OTHER 0x2000 /* "<other>" item that adds up the items pruned with --max-depth or --min-size */
+#define FF_SORTED 0x4000 /* the order of the sub items has been recorded by dirlist.c */
+#define FF_EXPND 0x8000 /* expanded in the tree view of the browser */
 
 /* Program states */
 #define ST_CALC   0
@@ -63,14 +68,16 @@
 #define ST_QUIT   5
 
 
-/* structure representing a file or directory */
+/* structure representing a file or directory. The parent, next and sub fields
+ * are references to other nodes rather than pointers, see arena.h. The name
+ * is a reference to the interned name, see names.h. The ext field is only
+ * used for items with FF_EXT, see util.h. */
 struct dir {
   int64_t size, asize;
   uint64_t ino, dev;
-  struct dir *parent, *next, *prev, *sub, *hlnk;
+  uint32_t parent, next, sub, name;
   int items;
-  unsigned short flags;
-  char name[];
+  unsigned short flags, ext;
 };
 
 /* A note on the ino and dev fields above: ino is usually represented as ino_t,
@@ -83,9 +90,10 @@ struct dir {
  * information is lost in this conversion, and the semantics remain the same.
  */
 
-/* Extended information for a struct dir. This struct is stored in the same
- * memory region as struct dir, placed after the name field. See util.h for
- * macros to help manage this. */
+/* Extended information for a struct dir. Only the mtime is stored with the
+ * item in the tree, placed right after the struct dir; the uid, gid and mode
+ * are kept in a dictionary shared by all items. See util.h for macros to help
+ * manage this. */
 struct dir_ext {
   uint64_t mtime;
   int uid, gid;
@@ -118,6 +126,9 @@ void close_nc(void);
 
 
 /* import all other global functions and variables */
+#include "arena.h"
+#include "names.h"
+#include "treefile.h"
 #include "browser.h"
 #include "delete.h"
 #include "dir.h"
@@ -32,11 +32,12 @@
 static int page, start;
 
 
-#define KEYS 19
+#define KEYS 22
 static const char *keys[KEYS*2] = {
 /*|----key----|  |----------------description----------------|*/
         "up, k", "Move cursor up",
       "down, j", "Move cursor down",
+          "0-9", "Jump to 0%, 10%, .. 90% of the list",
   "right/enter", "Open selected directory",
    "left, <, h", "Open parent directory",
             "n", "Sort by name (ascending/descending)",
@@ -50,6 +51,8 @@ static const char *keys[KEYS*2] = {
             "c", "Toggle display of child item counts",
             "m", "Toggle display of latest mtime (-e flag)",
             "e", "Show/hide hidden or excluded files",
+            "T", "Toggle tree view (expand dirs inline)",
+            "/", "Filter the list by name, Esc to clear",
             "i", "Show information about selected item",
             "r", "Recalculate the current directory",
             "b", "Spawn shell in current directory",
@@ -57,10 +60,12 @@ static const char *keys[KEYS*2] = {
 };
 
 
-#define FLAGS 9
+#define FLAGS 11
 static const char *flags[FLAGS*2] = {
     "!", "An error occurred while reading this directory",
     ".", "An error occurred while reading a subdirectory",
+    "?", "Incomplete, scan time budget ran out",
+    "+", "Collapsed to stay within --mem-limit, open to read",
     "<", "File or directory is excluded from the statistics",
     "e", "Empty directory",
     ">", "Directory was on another filesystem",
@@ -158,6 +163,14 @@ void help_draw() {
       ncprint( y+4, x+30, "%s", PACKAGE_VERSION);
       ncaddstr( 9,  7, "Written by Yoran Heling <projects@yorhel.nl>");
       ncaddstr(10, 16, "https://dev.yorhel.nl/ncdu/");
+      if(arena_mem) {
+        ncaddstr(12, 3, "Memory:");
+        printsize(UIC_DEFAULT, arena_mem + names_mem);
+        addstr("  names:");
+        printsize(UIC_DEFAULT, names_mem);
+        addstr("  saved:");
+        printsize(UIC_DEFAULT, names_saved);
+      }
       break;
   }
 }
@@ -31,6 +31,7 @@
 #include <errno.h>
 
 #include <unistd.h>
+#include <signal.h>
 #include <sys/time.h>
 
 #include <yopt.h>
@@ -50,6 +51,13 @@ static int ncurses_init = 0;
 static int ncurses_tty = 0; /* Explicitly open /dev/tty instead of using stdio */
 static long lastupdate = 999;
 
+/* Polling the keyboard and the clock for every item would slow down scanning
+ * and importing, so while those are running a timer tells when it's time to
+ * look again. */
+#define INPUT_TICK 20 /* ms */
+static volatile sig_atomic_t input_due = 1;
+static int input_timer = 0;
+
 
 static void screen_draw(void) {
   switch(pstate) {
@@ -63,6 +71,35 @@ static void screen_draw(void) {
 }
 
 
+static void input_tick(int sig) {
+  (void)sig;
+  input_due = 1;
+}
+
+
+/* Starts or stops the timer, it's only running while input_handle(1) is being
+ * called in a loop. */
+static void input_set_timer(int on) {
+  struct sigaction sa;
+  struct itimerval it;
+
+  if(on == input_timer)
+    return;
+  if(on) {
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = input_tick;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, NULL);
+  }
+  memset(&it, 0, sizeof(it));
+  it.it_interval.tv_usec = it.it_value.tv_usec = on ? INPUT_TICK*1000 : 0;
+  setitimer(ITIMER_REAL, &it, NULL);
+  input_timer = on;
+  input_due = 1;
+}
+
+
 /* wait:
  *  -1: non-blocking, always draw screen
  *   0: blocking wait for input and always draw screen
@@ -72,6 +109,12 @@ int input_handle(int wait) {
   int ch;
   struct timeval tv;
 
+  /* nothing to do until the next tick */
+  if(wait == 1 && input_timer && !input_due)
+    return 0;
+  input_set_timer(wait == 1);
+  input_due = 0;
+
   if(wait != 1)
     screen_draw();
   else {
@@ -98,6 +141,8 @@ int input_handle(int wait) {
       screen_draw();
       continue;
     }
+    /* there may be more keys waiting, don't wait for the next tick */
+    input_due = 1;
     switch(pstate) {
       case ST_CALC:   return dir_key(ch);
       case ST_BROWSE: return browse_key(ch);
@@ -113,14 +158,58 @@ int input_handle(int wait) {
 }
 
 
+/* Parses a duration in the form of "<num>[smh]", returns the number of
+ * seconds or -1 on error. */
+static long parse_time(const char *val) {
+  char *end;
+  long n, mul;
+
+  errno = 0;
+  n = strtol(val, &end, 10);
+  if(end == val || n < 0 || errno == ERANGE)
+    return -1;
+  switch(*end) {
+  case 0:
+  case 's': mul = 1; break;
+  case 'm': mul = 60; break;
+  case 'h': mul = 3600; break;
+  default: return -1;
+  }
+  return (*end && end[1]) || n > LONG_MAX/mul ? -1 : n*mul;
+}
+
+
+/* Parses a size in bytes with an optional K, M or G suffix */
+static int64_t parse_size(const char *val) {
+  char *end;
+  int64_t n;
+  int shift;
+
+  errno = 0;
+  n = strtoll(val, &end, 10);
+  if(end == val || n < 0 || errno == ERANGE)
+    return -1;
+  switch(*end) {
+  case 0: shift = 0; break;
+  case 'k': case 'K': shift = 10; break;
+  case 'm': case 'M': shift = 20; break;
+  case 'g': case 'G': shift = 30; break;
+  default: return -1;
+  }
+  return (*end && end[1]) || n > INT64_MAX >> shift ? -1 : n << shift;
+}
+
+
 /* parse command line */
 static void argv_parse(int argc, char **argv) {
   yopt_t yopt;
   int v;
-  char *val;
+  char *val, *end;
   char *export = NULL;
   char *import = NULL;
   char *dir = NULL;
+  char *tree = NULL;
+  struct dir *root;
 
   static yopt_opt_t opts[] = {
     { 'h', 0, "-h,-?,--help" },
@@ -144,6 +233,12 @@ static void argv_parse(int argc, char **argv) {
     { 's', 0, "--si" },
     { 'Q', 0, "--confirm-quit" },
     { 'c', 1, "--color" },
+    {  5,  1, "--time-budget" },
+    {  6,  0, "--compress-names" },
+    {  7,  1, "--tree-file" },
+    {  8,  1, "--mem-limit" },
+    {  9,  1, "--max-depth" },
+    { 10,  1, "--min-size" },
     {0,0,NULL}
   };
 
@@ -170,6 +265,12 @@ static void argv_parse(int argc, char **argv) {
       printf("  -X, --exclude-from FILE    Exclude files that match any pattern in FILE\n");
       printf("  -L, --follow-symlinks      Follow symbolic links (excluding directories)\n");
       printf("  --exclude-caches           Exclude directories containing CACHEDIR.TAG\n");
+      printf("  --time-budget TIME         Stop descending into directories after TIME (e.g. 90s, 5m, 1h)\n");
+      printf("  --compress-names           Use less memory for file names that share a prefix\n");
+      printf("  --tree-file FILE           Keep the tree in FILE, or browse the tree in FILE\n");
+      printf("  --mem-limit SIZE           Collapse directories to keep the tree below SIZE (e.g. 500M)\n");
+      printf("  --max-depth N              Add up everything below depth N into <other> items\n");
+      printf("  --min-size SIZE            Add up files smaller than SIZE into <other> items\n");
 #if HAVE_LINUX_MAGIC_H && HAVE_SYS_STATFS_H && HAVE_STATFS
       printf("  --exclude-kernfs           Exclude Linux pseudo filesystems (procfs,sysfs,cgroup,...)\n");
 #endif
@@ -226,6 +327,33 @@ static void argv_parse(int argc, char **argv) {
       fprintf(stderr, "This feature is not supported on your platform\n");
       exit(1);
 #endif
+    case  5 : /* --time-budget */
+      if((dir_scan_budget = parse_time(val)) <= 0) {
+        fprintf(stderr, "Invalid --time-budget: %s\n", val);
+        exit(1);
+      }
+      break;
+    case  6 : names_front_code = 1; break;
+    case  7 : tree = val; break;
+    case  8 : /* --mem-limit */
+      if((dir_mem_limit = parse_size(val)) <= 0) {
+        fprintf(stderr, "Invalid --mem-limit: %s\n", val);
+        exit(1);
+      }
+      break;
+    case  9 : /* --max-depth */
+      dir_max_depth = strtol(val, &end, 10);
+      if(end == val || *end || dir_max_depth < 0) {
+        fprintf(stderr, "Invalid --max-depth: %s\n", val);
+        exit(1);
+      }
+      break;
+    case 10 : /* --min-size */
+      if((dir_min_size = parse_size(val)) < 0) {
+        fprintf(stderr, "Invalid --min-size: %s\n", val);
+        exit(1);
+      }
+      break;
     case 'c':
       if(strcmp(val, "off") == 0)  { uic_theme = 0; }
       else if(strcmp(val, "dark") == 0) { uic_theme = 1; }
@@ -240,6 +368,24 @@ static void argv_parse(int argc, char **argv) {
     }
   }
 
+  /* Without a directory or file to import, an existing tree file is opened
+   * for browsing */
+  if(tree) {
+    if(export) {
+      fprintf(stderr, "The --tree-file option can't be used together with -o.\n");
+      exit(1);
+    }
+    v = !dir && !import && access(tree, F_OK) == 0;
+    if(!(root = treefile_open(tree, v))) {
+      fprintf(stderr, "Can't open %s: %s\n", tree, errno == EINVAL ? "not a valid tree file" : strerror(errno));
+      exit(1);
+    }
+    if(v) {
+      browse_init(root);
+      return;
+    }
+  }
+
   if(export) {
     if(dir_export_init(export)) {
       fprintf(stderr, "Can't open %s: %s\n", export, strerror(errno));
@@ -339,7 +485,8 @@ int main(int argc, char **argv) {
       init_nc();
     }
 
-    if(pstate == ST_CALC) {
+    /* a background refresh handles the browser keys while it runs */
+    if(pstate == ST_CALC || dir_ui == 3) {
       if(dir_process()) {
         if(dir_ui == 1)
           fputc('\n', stderr);
@@ -347,7 +494,14 @@ int main(int argc, char **argv) {
       }
     } else if(pstate == ST_DEL)
       delete_process();
-    else if(input_handle(0))
+    /* sort the opened directory a bit further when no keys are waiting */
+    else if(pstate == ST_BROWSE && dirlist_sort_pending()) {
+      lastupdate = -1;
+      input_due = 1;
+      if(input_handle(1))
+        break;
+      dirlist_sort_step();
+    } else if(input_handle(0))
       break;
   }
 
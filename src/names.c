@@ -0,0 +1,188 @@
+/* ncdu - NCurses Disk Usage
+
+  Copyright (c) 2020 Yoran Heling
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "global.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <khashl.h>
+
+
+char *names_chunks[NAMES_MAX_CHUNKS];
+int64_t names_mem, names_saved;
+int names_front_code = 0;
+
+static uint32_t chunks; /* number of allocated chunks */
+static uint32_t used;   /* number of bytes used in the last chunk */
+
+/* The last name added to the pool, its reference and the number of names
+ * since the last restart point, for front coding */
+static char *last;
+static size_t lastsize;
+static uint32_t lastref;
+static int chain;
+
+#define names_hash(r)     kh_hash_str(name_ptr(r))
+#define names_equal(a, b) (strcmp(name_ptr(a), name_ptr(b)) == 0)
+KHASHL_SET_INIT(KH_LOCAL, names_t, names, uint32_t, names_hash, names_equal)
+static names_t *table;
+
+
+/* Copies the first n bytes of the name at p into buf */
+static void name_prefix(const char *p, char *buf, size_t n) {
+  size_t plen = (unsigned char)p[-1];
+
+  if(!plen)
+    memcpy(buf, p, n);
+  else if(n <= plen)
+    name_prefix(p - ((unsigned char)p[-3] | (unsigned char)p[-2] << 8), buf, n);
+  else {
+    name_prefix(p - ((unsigned char)p[-3] | (unsigned char)p[-2] << 8), buf, plen);
+    memcpy(buf+plen, p, n-plen);
+  }
+}
+
+
+const char *name_decode(uint32_t ref) {
+  /* A few buffers are used in turn, so that the caller can compare two names
+   * or keep a name around while looking at another one. */
+  static char *buf[4];
+  static size_t bufsize[4];
+  static int cur;
+  const char *p = name_ptr_raw(ref);
+  size_t len = (unsigned char)p[-1] + strlen(p) + 1;
+
+  cur = (cur+1) & 3;
+  if(bufsize[cur] < len) {
+    bufsize[cur] = len < 256 ? 256 : len;
+    buf[cur] = xrealloc(buf[cur], bufsize[cur]);
+  }
+  name_prefix(p, buf[cur], len);
+  return buf[cur];
+}
+
+
+int name_char(uint32_t ref, int i) {
+  const char *p = name_ptr_raw(ref);
+  size_t plen = (unsigned char)p[-1];
+
+  if(i < 0 && (i += (int)(plen + strlen(p))) < 0)
+    return 0;
+  /* follow the references until the byte is in the stored part of a name */
+  while((plen = (unsigned char)p[-1]) && (size_t)i < plen)
+    p -= (unsigned char)p[-3] | (unsigned char)p[-2] << 8;
+  return (unsigned char)p[i-plen];
+}
+
+
+void names_reopen(uint32_t n, uint32_t u) {
+  chunks = n;
+  used = u;
+  names_mem += (int64_t)n * NAMES_CHUNK;
+}
+
+
+void names_state(uint32_t *n, uint32_t *u) {
+  *n = chunks;
+  *u = used;
+}
+
+
+uint32_t name_intern(const char *name) {
+  size_t len = strlen(name)+1, plen = 0, size;
+  khint_t k, cap;
+  uint32_t ref;
+  char *p;
+  int absent;
+
+  if(!table)
+    table = names_init();
+
+  /* Front code the name against the previous one if they share a long enough
+   * prefix, that one is close enough to refer to and the chain of coded names
+   * isn't too long yet. The restart points keep decoding cheap. */
+  if(names_front_code && last && chain < NAMES_RESTART) {
+    while(plen < 255 && plen < len-1 && name[plen] == last[plen])
+      plen++;
+    if(plen < 4 || ((chunks-1) << NAMES_CHUNK_BITS | (used+3)) - lastref > 0xffff)
+      plen = 0;
+  }
+  size = plen ? len-plen+3 : len;
+
+  /* Every chunk starts with a 0 byte, so that the byte before any name that
+   * isn't front coded is always 0 */
+  if(!chunks || used + size > NAMES_CHUNK) {
+    if(chunks == NAMES_MAX_CHUNKS) {
+      close_nc();
+      fprintf(stderr, "Too many file names, ncdu can't keep more than %d MiB of names in memory.\n", NAMES_MAX_CHUNKS*(NAMES_CHUNK/1024)/1024);
+      exit(1);
+    }
+    if(treefile_active)
+      treefile_names_chunk(chunks++);
+    else
+      names_chunks[chunks++] = xmalloc(NAMES_CHUNK);
+    names_chunks[chunks-1][0] = 0;
+    names_mem += NAMES_CHUNK;
+    used = 1;
+    plen = 0;
+    size = len;
+  }
+
+  /* Copy the name to the end of the pool, so that it has a reference to look
+   * up, and only keep it there if it wasn't in the pool yet.
+   * A front coded name is stored as the distance to the previous name (2
+   * bytes), the length of the shared prefix (1 byte) and the remaining
+   * suffix. */
+  p = names_chunks[chunks-1] + used;
+  if(plen) {
+    ref = ((chunks-1) << NAMES_CHUNK_BITS) | (used+3);
+    p[0] = (ref - lastref) & 0xff;
+    p[1] = (ref - lastref) >> 8;
+    p[2] = (char)plen;
+    p += 3;
+  } else
+    ref = ((chunks-1) << NAMES_CHUNK_BITS) | used;
+  memcpy(p, name+plen, len-plen);
+
+  cap = kh_capacity(table);
+  k = names_put(table, ref, &absent);
+  if(absent) {
+    used += size;
+    chain = plen ? chain+1 : 0;
+    lastref = ref;
+    if(names_front_code) {
+      if(lastsize < len) {
+        lastsize = len < 256 ? 256 : len;
+        last = xrealloc(last, lastsize);
+      }
+      memcpy(last, name, len);
+    }
+  } else
+    names_saved += len;
+  names_mem += (int64_t)(kh_capacity(table) - cap) * sizeof(uint32_t);
+  return kh_key(table, k);
+}
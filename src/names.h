@@ -0,0 +1,86 @@
+/* ncdu - NCurses Disk Usage
+
+  Copyright (c) 2020 Yoran Heling
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef _names_h
+#define _names_h
+
+#include "global.h"
+
+
+/* File names are interned: every distinct name is stored only once, in a
+ * pool of chunks that is shared by all trees, and nodes refer to it with a
+ * 32-bit reference. Names are never removed from the pool; the tree only
+ * grows during a scan, and the names of a refreshed or deleted subtree are
+ * likely to show up again.
+ *
+ * With names_front_code set, a name that shares a prefix with the name that
+ * was added before it (usually its previous sibling) only stores the part
+ * that differs. Such names are decoded into a temporary buffer when they're
+ * looked at; the returned string remains valid until a few other coded names
+ * have been decoded. */
+
+#define NAMES_CHUNK_BITS  20
+#define NAMES_CHUNK       (1<<NAMES_CHUNK_BITS)
+#define NAMES_MAX_CHUNKS  (1<<(32-NAMES_CHUNK_BITS))
+
+/* Maximum number of front coded names in a row */
+#define NAMES_RESTART 16
+
+extern char *names_chunks[NAMES_MAX_CHUNKS];
+
+/* Memory used by the pool and its index, and the number of bytes that
+ * didn't have to be stored because the name was already in the pool. */
+extern int64_t names_mem, names_saved;
+
+/* Whether new names are front coded, set with --compress-names */
+extern int names_front_code;
+
+/* Returns the reference to the interned copy of the given name */
+uint32_t name_intern(const char *);
+
+/* Gets or restores the number of chunks and the bytes used in the last one,
+ * for the tree file. The names in a reopened pool are not deduplicated
+ * against. */
+void names_state(uint32_t *, uint32_t *);
+void names_reopen(uint32_t, uint32_t);
+
+const char *name_decode(uint32_t);
+
+/* Returns the byte at index i of the name, counted from the end when i is
+ * negative, without decoding the rest of a front coded name. */
+int name_char(uint32_t, int);
+
+static inline const char *name_ptr_raw(uint32_t ref) {
+  return names_chunks[ref >> NAMES_CHUNK_BITS] + (ref & (NAMES_CHUNK-1));
+}
+
+static inline const char *name_ptr(uint32_t ref) {
+  const char *p = name_ptr_raw(ref);
+  return p[-1] ? name_decode(ref) : p;
+}
+
+#define dir_name(d) name_ptr((d)->name)
+
+#endif
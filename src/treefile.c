@@ -0,0 +1,225 @@
+/* ncdu - NCurses Disk Usage
+
+  Copyright (c) 2020 Yoran Heling
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include "global.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if HAVE_SYS_MMAN_H && HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+
+#define TF_MAGIC   "ncdutree"
+#define TF_VERSION 1
+
+/* Size of the header area, the extended info dictionary starts at TF_EXT */
+#define TF_HDR_SIZE ARENA_CHUNK
+#define TF_EXT      (256*1024)
+
+struct treefile_hdr {
+  char magic[8];
+  uint32_t version, dirsize, arena_chunk, names_chunk;
+  uint32_t root;                  /* reference to the root item, 0 if the tree isn't complete */
+  uint32_t names_chunks, names_used, ext_len;
+  uint32_t imported;              /* whether the tree was read with -f */
+  uint64_t size;                  /* size of the file */
+  unsigned char used[ARENA_MAX_CHUNKS/8];  /* bitmap of arena chunks in use */
+  uint64_t arena_off[ARENA_MAX_CHUNKS];    /* file offsets of the chunks, 0 if never used */
+  uint64_t names_off[NAMES_MAX_CHUNKS];
+};
+
+int treefile_active = 0;
+
+static int fd = -1;
+static struct treefile_hdr *hdr;
+static char *base; /* reserved address space for the arena chunks */
+
+
+#if HAVE_SYS_MMAN_H && HAVE_MMAP
+
+/* Arena chunks need to be aligned to their size and are always placed at
+ * base + id * ARENA_CHUNK, so reserve enough address space up front. */
+static int reserve(void) {
+  size_t len = (size_t)ARENA_MAX_CHUNKS * ARENA_CHUNK;
+  char *r = mmap(NULL, len + ARENA_CHUNK, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+  if(r == MAP_FAILED)
+    return -1;
+  base = (char *)(((uintptr_t)r + ARENA_CHUNK - 1) & ~(uintptr_t)(ARENA_CHUNK-1));
+  return 0;
+}
+
+
+static void *map(void *addr, size_t len, uint64_t off) {
+  void *r = mmap(addr, len, PROT_READ|PROT_WRITE, MAP_SHARED|(addr ? MAP_FIXED : 0), fd, (off_t)off);
+  if(r == MAP_FAILED) {
+    close_nc();
+    fprintf(stderr, "Error mapping the tree file: %s\n", strerror(errno));
+    exit(1);
+  }
+  return r;
+}
+
+
+/* Allocates the blocks of a range of the file, so that writing to the mapping
+ * can't fail with a SIGBUS when the file system fills up. Returns 0 or an error
+ * number. */
+static int allocate(uint64_t off, size_t len) {
+  static const char zero[65536];
+  ssize_t r;
+
+#if HAVE_POSIX_FALLOCATE
+  if((r = posix_fallocate(fd, (off_t)off, (off_t)len)) != EINVAL && r != EOPNOTSUPP)
+    return r;
+#endif
+  /* not supported by the file system, write the range instead */
+  while(len > 0) {
+    if((r = pwrite(fd, zero, len < sizeof(zero) ? len : sizeof(zero), (off_t)off)) < 0) {
+      if(errno == EINTR)
+        continue;
+      return errno;
+    }
+    off += r;
+    len -= r;
+  }
+  return 0;
+}
+
+
+/* Returns the offset of a new chunk of the given size at the end of the file */
+static uint64_t grow(size_t len) {
+  uint64_t off = hdr->size;
+  int r = allocate(off, len);
+  if(r) {
+    close_nc();
+    fprintf(stderr, "Error growing the tree file: %s\n", strerror(r));
+    exit(1);
+  }
+  hdr->size += len;
+  return off;
+}
+
+
+struct dir *treefile_open(const char *path, int reopen) {
+  struct treefile_hdr h;
+  uint32_t i;
+
+  if((fd = open(path, reopen ? O_RDWR : O_RDWR|O_CREAT|O_TRUNC, 0644)) < 0)
+    return NULL;
+
+  if(reopen) {
+    if(read(fd, &h, sizeof(h)) != sizeof(h) || memcmp(h.magic, TF_MAGIC, 8) != 0
+        || h.version != TF_VERSION || h.dirsize != sizeof(struct dir)
+        || h.arena_chunk != ARENA_CHUNK || h.names_chunk != NAMES_CHUNK || !h.root) {
+      errno = EINVAL;
+      return NULL;
+    }
+  } else if((errno = allocate(0, TF_HDR_SIZE)) != 0)
+    return NULL;
+
+  if(reserve() < 0)
+    return NULL;
+  hdr = map(NULL, TF_HDR_SIZE, 0);
+  treefile_active = 1;
+
+  if(!reopen) {
+    memcpy(hdr->magic, TF_MAGIC, 8);
+    hdr->version = TF_VERSION;
+    hdr->dirsize = sizeof(struct dir);
+    hdr->arena_chunk = ARENA_CHUNK;
+    hdr->names_chunk = NAMES_CHUNK;
+    hdr->size = TF_HDR_SIZE;
+    return (struct dir *)-1;
+  }
+
+  /* Map everything back at the same place and restore the state that isn't
+   * kept in the file */
+  arena_reopen(hdr->used);
+  for(i=0; i<hdr->names_chunks; i++)
+    treefile_names_chunk(i);
+  names_reopen(hdr->names_chunks, hdr->names_used);
+  dir_ext_reopen(hdr->ext_len);
+  dir_mem_reopen(dir_ptr(hdr->root));
+  dir_import_active = hdr->imported;
+  return dir_ptr(hdr->root);
+}
+
+
+void *treefile_arena_chunk(uint32_t id) {
+  if(!hdr->arena_off[id])
+    hdr->arena_off[id] = grow(ARENA_CHUNK);
+  hdr->used[id/8] |= 1<<(id%8);
+  return map(base + (size_t)id*ARENA_CHUNK, ARENA_CHUNK, hdr->arena_off[id]);
+}
+
+
+void treefile_arena_release(uint32_t id) {
+  hdr->used[id/8] &= ~(1<<(id%8));
+  mmap(base + (size_t)id*ARENA_CHUNK, ARENA_CHUNK, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED|MAP_NORESERVE, -1, 0);
+}
+
+
+char *treefile_names_chunk(uint32_t n) {
+  if(!hdr->names_off[n])
+    hdr->names_off[n] = grow(NAMES_CHUNK);
+  return names_chunks[n] = map(NULL, NAMES_CHUNK, hdr->names_off[n]);
+}
+
+
+struct dir_ext *treefile_ext_dict(void) {
+  return (struct dir_ext *)((char *)hdr + TF_EXT);
+}
+
+
+void treefile_sync(struct dir *root) {
+  if(!treefile_active)
+    return;
+  hdr->root = dir_ref(root);
+  names_state(&hdr->names_chunks, &hdr->names_used);
+  hdr->ext_len = dir_ext_count();
+  hdr->imported = dir_import_active;
+  msync(hdr, TF_HDR_SIZE, MS_ASYNC);
+}
+
+#else
+
+struct dir *treefile_open(const char *path, int reopen) {
+  (void)path; (void)reopen;
+  errno = ENOTSUP;
+  return NULL;
+}
+
+void *treefile_arena_chunk(uint32_t id) { (void)id; return NULL; }
+void treefile_arena_release(uint32_t id) { (void)id; }
+char *treefile_names_chunk(uint32_t n) { (void)n; return NULL; }
+struct dir_ext *treefile_ext_dict(void) { return NULL; }
+void treefile_sync(struct dir *root) { (void)root; }
+
+#endif
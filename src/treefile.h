@@ -0,0 +1,64 @@
+/* ncdu - NCurses Disk Usage
+
+  Copyright (c) 2020 Yoran Heling
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#ifndef _treefile_h
+#define _treefile_h
+
+#include "global.h"
+
+
+/* With --tree-file, the memory for the tree (the arena chunks, the name pool
+ * and the extended info dictionary) is mapped from a file instead of being
+ * allocated from the heap. The kernel can then write it out and page it back
+ * in as needed, so the tree may grow larger than the available memory. The
+ * file can be opened again later to browse the tree without scanning.
+ *
+ * The file starts with a header area, which holds the header and the
+ * extended info dictionary, followed by the chunks in the order they were
+ * first needed. */
+
+/* Whether a tree file is in use */
+extern int treefile_active;
+
+/* Opens or creates the tree file. When reopen is set, the tree in an existing
+ * file is loaded and returned, otherwise the file is truncated and (struct
+ * dir *)-1 returned. Returns NULL and sets errno on error. */
+struct dir *treefile_open(const char *, int reopen);
+
+/* Maps the memory for the given arena chunk or name pool chunk */
+void *treefile_arena_chunk(uint32_t);
+char *treefile_names_chunk(uint32_t);
+
+/* Releases the memory of an arena chunk, its space in the file is reused when
+ * a chunk with the same id is needed again. */
+void treefile_arena_release(uint32_t);
+
+/* Storage for the extended info dictionary */
+struct dir_ext *treefile_ext_dict(void);
+
+/* Updates the header to describe the current tree, given its root */
+void treefile_sync(struct dir *);
+
+#endif
@@ -30,6 +30,7 @@
 #include <ncurses.h>
 #include <stdarg.h>
 #include <unistd.h>
+#include <khashl.h>
 #ifdef HAVE_LOCALE_H
 #include <locale.h>
 #endif
@@ -280,35 +281,20 @@ void uic_set(enum ui_coltype c) {
 
 /* removes item from the hlnk circular linked list and size counts of the parents */
 static void freedir_hlnk(struct dir *d) {
-  struct dir *t, *par, *pt;
-  int i;
+  struct dir *par, *top;
 
   if(!(d->flags & FF_HLNKC))
     return;
+  arena_of(d)->hlnkc--;
 
   /* remove size from parents.
    * This works the same as with adding: only the parents in which THIS is the
    * only occurrence of the hard link will be modified, if the same file still
-   * exists within the parent it shouldn't get removed from the count.
-   * XXX: Same note as for dir_mem.c / hlink_check():
-   *      this is probably not the most efficient algorithm */
-  for(i=1,par=d->parent; i&&par; par=par->parent) {
-    if(d->hlnk)
-      for(t=d->hlnk; i&&t!=d; t=t->hlnk)
-        for(pt=t->parent; i&&pt; pt=pt->parent)
-          if(pt==par)
-            i=0;
-    if(i) {
-      par->size = adds64(par->size, -d->size);
-      par->asize = adds64(par->size, -d->asize);
-    }
-  }
-
-  /* remove from hlnk */
-  if(d->hlnk) {
-    for(t=d->hlnk; t->hlnk!=d; t=t->hlnk)
-      ;
-    t->hlnk = d->hlnk;
+   * exists within the parent it shouldn't get removed from the count. */
+  top = dir_hlnk_update(d, -1);
+  for(par=dir_parent(d); par!=top; par=dir_parent(par)) {
+    par->size = adds64(par->size, -d->size);
+    par->asize = adds64(par->asize, -d->asize);
   }
 }
 
@@ -318,40 +304,62 @@ static void freedir_rec(struct dir *dr) {
   tmp2 = dr;
   while((tmp = tmp2) != NULL) {
     freedir_hlnk(tmp);
+    dirlist_free(tmp);
     /* remove item */
-    if(tmp->sub) freedir_rec(tmp->sub);
-    tmp2 = tmp->next;
-    free(tmp);
+    if(tmp->sub) freedir_rec(dir_sub(tmp));
+    tmp2 = dir_next(tmp);
+    arena_free(tmp, dir_item_memsize(tmp->flags, tmp->ext));
   }
 }
 
 
 void freedir(struct dir *dr) {
+  struct dir *par, *t;
+  struct arena *a;
+  int drop;
+
   if(!dr)
     return;
 
-  /* free dr->sub recursively */
-  if(dr->sub)
-    freedir_rec(dr->sub);
-
-  /* update references */
-  if(dr->parent && dr->parent->sub == dr)
-    dr->parent->sub = dr->next;
-  if(dr->prev)
-    dr->prev->next = dr->next;
-  if(dr->next)
-    dr->next->prev = dr->prev;
+  /* If dr is the root of its own arena and there are no hard links or other
+   * arenas to worry about, the whole subtree can be dropped at once. */
+  a = arena_of(dr);
+  drop = a->owner == dr && !a->nested && !a->hlnkc;
+
+  /* otherwise, free dr->sub recursively */
+  if(dr->sub && !drop)
+    freedir_rec(dir_sub(dr));
+
+  /* update references, there's no link to the previous item so that has to
+   * be looked up in the list */
+  par = dir_parent(dr);
+  if(par && par->sub == dir_ref(dr))
+    par->sub = dr->next;
+  else if(par) {
+    for(t=dir_sub(par); t && t->next != dir_ref(dr); t=dir_next(t))
+      ;
+    if(t)
+      t->next = dr->next;
+  }
 
   freedir_hlnk(dr);
+  if(drop)
+    dirlist_free_arena(a);
+  else
+    dirlist_free(dr);
 
   /* update sizes of parent directories if this isn't a hard link.
    * If this is a hard link, freedir_hlnk() would have done so already
    *
    * mtime is 0 here because recalculating the maximum at every parent
    * dir is expensive, but might be good feature to add later if desired */
-  addparentstats(dr->parent, dr->flags & FF_HLNKC ? 0 : -dr->size, dr->flags & FF_HLNKC ? 0 : -dr->asize, 0, -(dr->items+1));
+  addparentstats(par, dr->flags & FF_HLNKC ? 0 : -dr->size, dr->flags & FF_HLNKC ? 0 : -dr->asize, 0, -(dr->items+1));
+  dirlist_changed(par);
 
-  free(dr);
+  if(drop)
+    arena_destroy(a);
+  else
+    arena_free(dr, dir_item_memsize(dr->flags, dr->ext));
 }
 
 
@@ -361,12 +369,12 @@ const char *getpath(struct dir *cur) {
   struct dir *d, **list;
   int c, i;
 
-  if(!cur->name[0])
+  if(!dir_name(cur)[0])
     return "/";
 
   c = i = 1;
-  for(d=cur; d!=NULL; d=d->parent) {
-    i += strlen(d->name)+1;
+  for(d=cur; d!=NULL; d=dir_parent(d)) {
+    i += strlen(dir_name(d))+1;
     c++;
   }
 
@@ -380,14 +388,14 @@ const char *getpath(struct dir *cur) {
   list = xmalloc(c*sizeof(struct dir *));
 
   c = 0;
-  for(d=cur; d!=NULL; d=d->parent)
+  for(d=cur; d!=NULL; d=dir_parent(d))
     list[c++] = d;
 
   dat[0] = '\0';
   while(c--) {
     if(list[c]->parent)
       strcat(dat, "/");
-    strcat(dat, list[c]->name);
+    strcat(dat, dir_name(list[c]));
   }
   free(list);
   return dat;
@@ -396,22 +404,100 @@ const char *getpath(struct dir *cur) {
 
 struct dir *getroot(struct dir *d) {
   while(d && d->parent)
-    d = d->parent;
+    d = dir_parent(d);
   return d;
 }
 
 
+#define ext_hash(i)     (kh_hash_uint32(ext_dict[i].uid) ^ kh_hash_uint32(ext_dict[i].gid ^ ((unsigned)ext_dict[i].mode << 16)))
+#define ext_equal(a, b) (ext_dict[a].uid == ext_dict[b].uid && ext_dict[a].gid == ext_dict[b].gid && ext_dict[a].mode == ext_dict[b].mode)
+KHASHL_SET_INIT(KH_LOCAL, extd_t, extd, unsigned short, ext_hash, ext_equal)
+static extd_t *ext_table;
+static int ext_len, ext_size;
+struct dir_ext *ext_dict;
+
+
+unsigned short dir_ext_intern(const struct dir_ext *e) {
+  khint_t k;
+  int absent;
+
+  if(!ext_table) {
+    ext_table = extd_init();
+    if(treefile_active) {
+      ext_dict = treefile_ext_dict();
+      ext_size = DIR_EXT_INLINE+1;
+    }
+  }
+
+  /* like name_intern(), add the entry at the end and look it up */
+  if(ext_len == ext_size) {
+    ext_size = ext_size ? ext_size*2 : 64;
+    ext_dict = xrealloc(ext_dict, ext_size*sizeof(*ext_dict));
+  }
+  ext_dict[ext_len] = *e;
+  ext_dict[ext_len].mtime = 0;
+
+  k = extd_put(ext_table, (unsigned short)ext_len, &absent);
+  if(!absent)
+    return kh_key(ext_table, k);
+  if(ext_len == DIR_EXT_INLINE) {
+    extd_del(ext_table, k);
+    return DIR_EXT_INLINE;
+  }
+  return (unsigned short)ext_len++;
+}
+
+
+void dir_ext_reopen(int len) {
+  int absent;
+
+  ext_table = extd_init();
+  ext_dict = treefile_ext_dict();
+  ext_size = DIR_EXT_INLINE+1;
+  for(ext_len=0; ext_len<len; ext_len++)
+    extd_put(ext_table, (unsigned short)ext_len, &absent);
+}
+
+
+int dir_ext_count(void) {
+  return ext_len;
+}
+
+
+void dir_ext_set(struct dir *d, const struct dir_ext *e) {
+  if(d->ext == DIR_EXT_INLINE)
+    memcpy(dir_mtime_ptr(d), e, sizeof(struct dir_ext));
+  else
+    *dir_mtime_ptr(d) = e->mtime;
+}
+
+
+struct dir_ext *dir_ext_get(struct dir *d) {
+  static struct dir_ext e;
+
+  if(!(d->flags & FF_EXT))
+    return NULL;
+  if(d->ext == DIR_EXT_INLINE)
+    memcpy(&e, dir_mtime_ptr(d), sizeof(struct dir_ext));
+  else {
+    e = ext_dict[d->ext];
+    e.mtime = *dir_mtime_ptr(d);
+  }
+  return &e;
+}
+
+
 void addparentstats(struct dir *d, int64_t size, int64_t asize, uint64_t mtime, int items) {
-  struct dir_ext *e;
+  uint64_t *m;
   while(d) {
     d->size = adds64(d->size, size);
     d->asize = adds64(d->asize, asize);
     d->items += items;
     if (d->flags & FF_EXT) {
-      e = dir_ext_ptr(d);
-      e->mtime = (e->mtime > mtime) ? e->mtime : mtime;
+      m = dir_mtime_ptr(d);
+      *m = (*m > mtime) ? *m : mtime;
     }
-    d = d->parent;
+    d = dir_parent(d);
   }
 }
 
@@ -432,3 +518,9 @@ void addparentstats(struct dir *d, int64_t size, int64_t asize, uint64_t mtime,
 void *xmalloc(size_t size) { wrap_oom(malloc(size)) }
 void *xcalloc(size_t n, size_t size) { wrap_oom(calloc(n, size)) }
 void *xrealloc(void *mem, size_t size) { wrap_oom(realloc(mem, size)) }
+
+static void *memalign_or_null(size_t align, size_t size) {
+  void *ptr;
+  return posix_memalign(&ptr, align, size) ? NULL : ptr;
+}
+void *xmemalign(size_t align, size_t size) { wrap_oom(memalign_or_null(align, size)) }
@@ -76,16 +76,43 @@ extern int si;
 
 /* Macros/functions for managing struct dir and struct dir_ext */
 
-#define dir_memsize(n)     (offsetof(struct dir, name)+1+strlen(n))
-#define dir_ext_offset(n)  ((dir_memsize(n) + 7) & ~7)
-#define dir_ext_memsize(n) (dir_ext_offset(n) + sizeof(struct dir_ext))
+/* The ext field of a struct dir is an index into ext_dict, which holds the
+ * uid, gid and mode of each item. When the dictionary is full, ext is set to
+ * DIR_EXT_INLINE and the complete struct dir_ext is stored with the item
+ * instead of only the mtime. */
+#define DIR_EXT_INLINE 0xffff
+extern struct dir_ext *ext_dict;
 
-static inline struct dir_ext *dir_ext_ptr(struct dir *d) {
+#define dir_ext_memsize(x)     ((x) == DIR_EXT_INLINE ? sizeof(struct dir_ext) : sizeof(uint64_t))
+
+/* Memory required for an item with the given flags and ext index */
+#define dir_item_memsize(f, x) (sizeof(struct dir) + ((f) & FF_EXT ? dir_ext_memsize(x) : 0))
+
+/* Returns the ext index for the given extended information, adding it to the
+ * dictionary if necessary */
+unsigned short dir_ext_intern(const struct dir_ext *);
+
+/* Restores the dictionary from the tree file, or returns its size */
+void dir_ext_reopen(int);
+int dir_ext_count(void);
+
+/* Stores the extended information with an item, d->ext must have been set by
+ * dir_ext_intern() */
+void dir_ext_set(struct dir *, const struct dir_ext *);
+
+/* Returns the extended information of an item, or NULL if it doesn't have
+ * any. The returned struct may be overwritten with a subsequent call. */
+struct dir_ext *dir_ext_get(struct dir *);
+
+/* The mtime is at the start of the extended information in either case */
+static inline uint64_t *dir_mtime_ptr(struct dir *d) {
   return d->flags & FF_EXT
-    ? (struct dir_ext *) ( ((char *)d) + dir_ext_offset(d->name) )
+    ? (uint64_t *) ( ((char *)d) + sizeof(struct dir) )
     : NULL;
 }
 
+#define dir_mtime(d) ((d)->flags & FF_EXT ? *dir_mtime_ptr(d) : 0)
+
 
 /* Instead of using several ncurses windows, we only draw to stdscr.
  * the functions nccreate, ncprint and the macros ncaddstr and ncaddch
@@ -143,7 +170,7 @@ char *fmtmode(unsigned short);
 /* read locale information from the environment */
 void read_locale(void);
 
-/* recursively free()s a directory tree */
+/* recursively frees a directory tree, see arena.h */
 void freedir(struct dir *);
 
 /* generates full path from a dir item,
@@ -190,6 +217,7 @@ void addparentstats(struct dir *, int64_t, int64_t, uint64_t, int);
 void *xmalloc(size_t);
 void *xcalloc(size_t, size_t);
 void *xrealloc(void *, size_t);
+void *xmemalign(size_t, size_t);
 
 #endif
 